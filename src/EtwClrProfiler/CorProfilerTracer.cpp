@@ -26,7 +26,48 @@
 // Defines the EventWrite* operations.  
 #include "ETWInterface.h"
 
+#include <algorithm>
+#include <intrin.h>
+#include <immintrin.h>
+
 #define MaxEventPayload 0xFD00       // Maximum payload size for an ETW event (with some spare for small amounts of 'header' information. 
+#define FragmentationBucketCount 40  // Free gaps are bucketed by power of 2, thus this covers gaps up to 1TB.  
+#define HandleAgeBucketCount 16      // Handle ages (in GCs) are bucketed by power of 2
+#define FinalizerSummaryTopN 20         // The number of types we log FinalizerSummary events for in each GC
+#define PromotionSampleRate 16          // For GCPromotion we look up the type of 1 in this many survivors.  
+#define PromotionTopN 100               // The number of types we log in each GCPromotion event.  
+#define DuplicateStringTopN 20          // The number of strings we log DuplicateString events for in each gen 2 GC
+#define DuplicateStringSketchDepth 4    // The count-min sketch used to count strings has this many rows 
+#define DuplicateStringSketchWidth 16384  // of this many counters (must be a power of 2)
+#define DuplicateStringCandidates 1024  // The number of slots we have for remembering the most duplicated strings (must be a power of 2)
+#define DuplicateStringMaxChars 256     // We truncate the string values we log to this many characters.  
+#define ArrayWasteMinSize 85000         // By default we scan arrays that are on the large object heap (PerfView_ArrayWasteMinSize overrides this)
+#define ArrayWasteScanBudget 0x2000000  // The number of bytes of arrays we are willing to scan in one GC (32MB)
+#define ArrayMaxRank 32
+#define CallSamplingRateDefault 997     // CallSampled logs 1 in this many calls.  Prime, so it is likely to be uncorrelated with things.  
+#define HeapSampleRate 64               // By default GCHeapSampled logs 1 in this many objects (PerfView_HeapSampleRate overrides this)
+#define HandleSummaryIntervalMSec 1000  // How often (at most) we log the GCHandleSummary events (we only do it at the end of a GC).  
+#define MethodLatencyMaxMethods 256     // The most methods PerfView_MethodLatency can select (must be a power of 2)
+#define MethodLatencyMaxDepth 32        // How deeply the selected methods can be nested (recursion) on one thread and still be timed
+#define MethodNameMaxChars 512          // The longest Type.Method name we match against the PerfView_MethodLatency and PerfView_CallScopeAnchors patterns
+#define DefinedFunctionCacheSize 64     // The number of FunctionIDs each thread remembers it logged definitions for (must be a power of 2)
+#define CallScopeMaxAnchors 64          // The most methods PerfView_CallScopeAnchors can select (must be a power of 2)
+#define CallScopeIdleCount 0x10000      // Outside an anchor's scope, CallScoped only looks at 1 in this many calls (to notice it was turned off) 
+#define CallStackMaxDepth 48           // CallStacks logs at most this many frames of each sampled stack
+#define CpuSampleIntervalMSec 10        // By default CpuSamples samples the managed threads this often (PerfView_CpuSampleMSec overrides this)
+#define CpuSampleLogIntervalMSec 1000   // How often the sampling thread logs the CpuSampleCounts it has accumulated
+#define JitMaxDepth 8                   // How deeply JIT compilations can nest on one thread and still be timed
+#define JitTopN 100                     // The number of methods JitLatency logs (the ones that took longest to compile)
+#define PerfMapFlushMSec 100            // How often the perf map writer thread writes the lines it has been given
+#define GCPauseHistogramIntervalMSec 1000 // How often (at most) we log the GCPauseHistogram events (we only do it when the runtime resumes).  
+#define TransitionMaxDepth 8            // Transitions times P/Invokes nested this deep on a thread (calls from native code can nest them)
+#define ExceptionStackSampleRate 10     // Exceptions samples the stack of 1 in this many throws of each type (PerfView_ExceptionStackRate overrides this)
+#define SafePointTopN 4                 // SafePoints logs this many of the threads that were slowest to reach a safe point
+#define SuspendReasonCount 10           // COR_PRF_SUSPEND_FOR_PROFILER (9) is the largest COR_PRF_SUSPEND_REASON
+#define StartupTimelineSeconds 30       // By default StartupTimeline records the first this many seconds (PerfView_StartupSeconds overrides this)
+#define FrameCacheSize 512              // The number of return addresses each thread's CallStacks cache remembers (must be a power of 2)
+#define LatencySubBucketBits 3          // MethodLatency splits each power of 2 into this many bits worth of histogram buckets
+#define LatencyBucketCount ((64 - LatencySubBucketBits + 1) << LatencySubBucketBits)
 
 //============================================================================
 // Elements of this class are put in the m_classInfo to remember things about our class
@@ -34,10 +75,15 @@ class ClassInfo
 {
 public:
 	ClassInfo() {
-		ID = 0; Token = 0; ModuleInfo = NULL; Size = 0; Flags = (CorTypeAttr)0; Name = NULL;
+		ID = 0; Token = 0; ModuleInfo = NULL; Size = 0; Flags = (CorTypeAttr)0; Name = NULL; IsArray = false;
 		elemType = ELEMENT_TYPE_END; elemClassId = 0; rank = 0;
 		TickOfCurrentTimeBucket = 0; AllocCountInCurrentBucket = 0; AllocPerMSec = 0; SamplingRate = 0; AllocsIgnored = 0; IgnoredSize = 0;
 		ForceKeepSize = 10000;			// By default we keep all instances greater than 10K for all types.  
+		FinalizeQueuedCount = 0;
+		PromotedCount = 0; PromotedSize = 0;
+		ArrayScanCount = 0; ArraySkippedCount = 0; ArrayScanBytes = 0; ArrayZeroBytes = 0; ArrayTrailingZeroBytes = 0;
+		UnsampledCount = 0; UnsampledSize = 0;
+		ThrowCount = 0; ExceptionSearchTicks = 0; ExceptionUnwindTicks = 0;
 	}
 	~ClassInfo() { if (Name != NULL) delete Name; }
 
@@ -65,6 +111,29 @@ public:
 	ULONG AllocsIgnored;			// The current number of data points ignored.  
 	ULONG IgnoredSize;
 	ULONG ForceKeepSize;			// objects above this value will be kept unconditionally.   Setting to 0 forces all instances of this type to be kept. 
+
+	/* Used for the FinalizerSummary */
+	ULONG FinalizeQueuedCount;		// The number of instances queued for finalization in the current GC.  
+
+	/* Used for GCPromotion (sampled) */
+	ULONG PromotedCount;			// The number of sampled instances that survived the current GC. 
+	ULONGLONG PromotedSize;
+
+	/* Used for ArrayWaste */
+	ULONG ArrayScanCount;			// The number of large arrays of this type scanned in the current GC. 
+	ULONG ArraySkippedCount;		// The number of large arrays of this type we did not scan because we ran out of budget.  
+	ULONGLONG ArrayScanBytes;
+	ULONGLONG ArrayZeroBytes;
+	ULONGLONG ArrayTrailingZeroBytes;
+
+	/* Used for GCHeapSampled */
+	ULONG UnsampledCount;			// The number of instances in this GC's heap walk that we did NOT log.  
+	ULONGLONG UnsampledSize;
+
+	/* Used for Exceptions (when this is an exception type) */
+	ULONG ThrowCount;				// The number of instances thrown so far.  
+	ULONGLONG ExceptionSearchTicks;	// The time spent looking for their handlers.  
+	ULONGLONG ExceptionUnwindTicks;	// The time spent unwinding to their handlers.  
 };
 
 //============================================================================
@@ -72,7 +141,7 @@ public:
 class ModuleInfo
 {
 public:
-	ModuleInfo(ModuleID moduleId) : ID(moduleId), MetaDataFailed(false) { AssemblyID = 0; MetaDataImport = NULL; Path = NULL; }
+	ModuleInfo(ModuleID moduleId) : ID(moduleId), MetaDataFailed(false) { AssemblyID = 0; MetaDataImport = NULL; Path = NULL; JitCount = 0; JitTicks = 0; }
 	~ModuleInfo() {
 		if (MetaDataImport != NULL) MetaDataImport->Release();
 		if (Path != NULL) delete Path;
@@ -83,645 +152,4396 @@ public:
 	AssemblyID AssemblyID;
 	IMetaDataImport* MetaDataImport;    // We Release() this pointer on when we die
 	wchar_t* Path;                      // We DO own this pointer (we delete it when we die)
+	ULONG JitCount;                     // For JitLatency, the number of methods in this module we saw compiled and how long they took
+	ULONGLONG JitTicks;
 };
 
 //============================================================================
-// We registered this in ::Initialize to be invoked when there are ETW commands
-// It just forwards to DoETWCommand
-void WINAPI ProfilerControlCallback(
-	LPCGUID SourceId,
-	ULONG IsEnabled,
-	UCHAR Level,
-	ULONGLONG MatchAnyKeywords,
-	ULONGLONG MatchAllKeywords,
-	PEVENT_FILTER_DESCRIPTOR FilterData,
-	PVOID CallbackContext)
+// Elements of this class are put in the m_functionInfo to remember things about our methods
+class FunctionInfo
 {
-	UNREFERENCED_PARAMETER(SourceId);
-	UNREFERENCED_PARAMETER(MatchAllKeywords);
-
-	CorProfilerTracer* profiler = (CorProfilerTracer*)CallbackContext;
-	LOG_TRACE(L"ProfilerControlCallback DoETWCommand IsEnabled 0x%x Level 0x%xI64 MatchAny 0x%x\n", IsEnabled, Level, MatchAnyKeywords);
-	profiler->DoETWCommand(IsEnabled, Level, MatchAnyKeywords, FilterData);
-}
-
-//==============================================================================
-// Used for call count profiling
-
-// TODO presently unused.   Only needed if the callback needs the TracerState
-// static CorProfilerTracer* s_tracer = NULL;
+public:
+	FunctionInfo() { ID = 0; Token = 0; Class = 0; ModuleInfo = NULL; Name = NULL; JitCount = 0; JitTicks = 0; }
+	~FunctionInfo() { if (Name != NULL) delete[] Name; }
 
-//************************
-EXTERN_C int CallSampleCount = 1;	// This counts down to 0 for sampling 
-int CallSamplingRate = 1;			// The number of calls to skip before taking a sample.  
+	FunctionID ID;
+	mdMethodDef Token;
+	ClassID Class;				// 0 if it is shared by generic instantiations 
+	ModuleInfo* ModuleInfo;     // We don't own this pointer (we don't delete it when we die)
+	wchar_t* Name;              // We DO own this pointer (we delete it when we die)
+	ULONG JitCount;             // For JitLatency, the number of times we saw this method compiled and how long it took
+	ULONGLONG JitTicks;
+};
 
-EXTERN_C void __stdcall EnterMethod(FunctionID functionID)
+//============================================================================
+// LiveHandleTable is a open addressing (linear probing) hash table from a GCHandleID to what we knew 
+// about the handle when it was created.   It is used by the GCHandleSummary keyword to track the live 
+// handles without logging every HandleCreated and HandleDestroyed.   Removing a handle shifts the entries 
+// after it back, so there are no tombstones and the table never needs to be cleaned up.  
+// It does no locking, the caller must do that.  
+class LiveHandleTable
 {
-	EventWriteCallEnterEvent(functionID, CallSamplingRate);
-	CallSampleCount = CallSamplingRate;
-}
-
-#if defined(_M_IX86)
-// see http://msdn.microsoft.com/en-us/library/4ks26t93.aspx  for inline assembly.   Not supported on X64.   
+public:
+	LiveHandleTable() : m_entries(NULL), m_capacity(0), m_count(0) { Resize(1024); }
+	~LiveHandleTable() { delete[] m_entries; }
 
-void __declspec(naked) __stdcall EnterMethodNaked(FunctionIDOrClientID)
-{
-	__asm
+	void Add(GCHandleID handleId, ClassID initialClassId, int creationGC)
 	{
-		lock dec[CallSampleCount]
-		jle TakeSample
-		ret 4
+		if ((m_count + 1) * 2 > m_capacity)
+			Resize(m_capacity * 2);
 
-		TakeSample:
-		push eax
-			push ecx
-			push edx
-			push[esp + 16]		// Push the function ID
-			call EnterMethod
-			pop edx
-			pop ecx
-			pop eax
-			ret 4
-	}
-} // EnterNaked
+		ULONG idx = HomeSlot(handleId);
+		while (m_entries[idx].HandleID != 0 && m_entries[idx].HandleID != handleId)
+			idx = (idx + 1) & (m_capacity - 1);
+		if (m_entries[idx].HandleID == 0)
+			m_count++;
 
-void __declspec(naked) __stdcall TailcallMethodNaked(FunctionIDOrClientID)
-{
-	__asm
-	{
-		jmp EnterMethodNaked
+		m_entries[idx].HandleID = handleId;
+		m_entries[idx].InitialClassID = initialClassId;
+		m_entries[idx].CreationGC = creationGC;
 	}
-}
 
-#else
-EXTERN_C void __stdcall EnterMethodNaked(FunctionIDOrClientID functionID);
-EXTERN_C void __stdcall TailcallMethodNaked(FunctionIDOrClientID functionID);
-#endif 
+	// It is OK to remove handles we don't know about (e.g. were created before we were turned on).  
+	void Remove(GCHandleID handleId)
+	{
+		const ULONG mask = m_capacity - 1;
+		ULONG idx = HomeSlot(handleId);
+		for (;;)
+		{
+			if (m_entries[idx].HandleID == 0)
+				return;
+			if (m_entries[idx].HandleID == handleId)
+				break;
+			idx = (idx + 1) & mask;
+		}
 
-//==========================================================================
-// The constructor does almost nothing because we need the ability to call
-// back to the runtime.   Thus the 'real' initialization happens in
-// this routine.   In particular we register ProfilerControlCallback with
-// ETW.
-// We make Initialize call this routine with pvClientData = NULL, cbClientData = -1;
-HRESULT STDMETHODCALLTYPE CorProfilerTracer::InitializeForAttach(
-	/* [in] */ IUnknown *pICorProfilerInfoUnk,
-	/* [in] */ void *pvClientData,
-	/* [in] */ UINT cbClientData)
-{
-	UNREFERENCED_PARAMETER(pvClientData);
+		// Move back any entry in the probe sequence that would not be found after we empty idx.  
+		ULONG hole = idx;
+		for (ULONG next = (hole + 1) & mask; m_entries[next].HandleID != 0; next = (next + 1) & mask)
+		{
+			ULONG home = HomeSlot(m_entries[next].HandleID);
+			// The entry can stay if its home slot is (cyclically) in (hole, next]
+			bool canStay = (hole < next) ? (hole < home && home <= next) : (hole < home || home <= next);
+			if (!canStay)
+			{
+				m_entries[hole] = m_entries[next];
+				hole = next;
+			}
+		}
+		m_entries[hole].HandleID = 0;
+		--m_count;
+	}
 
-	HRESULT             hr = S_OK;
-	LOG_TRACE(L"ClrProfiler Initializing\n");
-	CALL_N_LOGONBADHR(pICorProfilerInfoUnk->QueryInterface(__uuidof(ICorProfilerInfo3), (void **)&m_info));
+	void Clear() { memset(m_entries, 0, m_capacity * sizeof(LiveHandle)); m_count = 0; }
 
-	// In my Initialize() method I call InitializeForAttach with cbClientData == -1.   This is convenient 
-	// since most of the logic is the same.  
-	m_profilerLoadedAtStartup = ((int)cbClientData < 0);
+	// Iteration is over all the slots, skip the ones with a HandleID of 0. 
+	ULONG Capacity() { return m_capacity; }
+	const LiveHandle& operator[](ULONG idx) { return m_entries[idx]; }
+	ULONG Count() { return m_count; }
 
-	// Initialize the ETW Provider.  
-	LOG_TRACE(L"Registering the ETW provider\n");
-	CALL_N_LOGONBADHR(EventRegisterETWClrProfiler(ProfilerControlCallback, this));
+private:
+	ULONG HomeSlot(GCHandleID handleId)
+	{
+		// Handles are pointer aligned, so multiply by a large odd number (Fibonacci hashing) and use the high bits.  
+		ULONGLONG hash = ((ULONGLONG)handleId) * 0x9E3779B97F4A7C15ULL;
+		return (ULONG)(hash >> 32) & (m_capacity - 1);
+	}
 
-	// If we are not attaching, turn on all the events we can only turned on at init time.  
-	if (m_profilerLoadedAtStartup)
+	void Resize(ULONG newCapacity)
 	{
-		// Even if we did not ask for them, turn on the profiler flags that can ONLY be done at startup. 
-		DWORD oldFlags = 0;
-		CALL_N_LOGONBADHR(m_info->GetEventMask(&oldFlags));
-		CALL_N_LOGONBADHR(m_info->SetEventMask(oldFlags | COR_PRF_MONITOR_MODULE_LOADS | COR_PRF_ENABLE_OBJECT_ALLOCATED));
+		LiveHandle* oldEntries = m_entries;
+		ULONG oldCapacity = m_capacity;
 
-		// See if we asked for call sampling or not.  
-		DWORD keywords = 0;
-		DWORD keywordsSize = sizeof(keywords);
-		int hrRegGetValue = RegGetValue(HKEY_LOCAL_MACHINE, L"Software\\Microsoft\\.NETFramework", L"PerfView_Keywords", RRF_RT_DWORD, NULL, &keywords, &keywordsSize);
-		if (hrRegGetValue == ERROR_SUCCESS)
+		m_entries = new LiveHandle[newCapacity];
+		memset(m_entries, 0, newCapacity * sizeof(LiveHandle));
+		m_capacity = newCapacity;
+		m_count = 0;
+		for (ULONG i = 0; i < oldCapacity; i++)
 		{
-			if ((keywords & DisableInliningKeyword) != 0)
-			{
-				CALL_N_LOGONBADHR(m_info->GetEventMask(&oldFlags));
-				CALL_N_LOGONBADHR(m_info->SetEventMask(oldFlags | COR_PRF_DISABLE_INLINING));
-			}
-
-			if ((keywords & (CallKeyword | CallSampledKeyword)) != 0)
-			{
-				// assert(s_tracer == NULL);	// Don't need any information passed around so I don't need this.  
-				// s_tracer = this;
+			if (oldEntries[i].HandleID != 0)
+				Add(oldEntries[i].HandleID, oldEntries[i].InitialClassID, oldEntries[i].CreationGC);
+		}
+		delete[] oldEntries;
+	}
 
-				// Turn on the Call entry and leave hooks.  
-				CALL_N_LOGONBADHR(m_info->SetEnterLeaveFunctionHooks3(EnterMethodNaked, 0, TailcallMethodNaked));
-				CALL_N_LOGONBADHR(m_info->GetEventMask(&oldFlags));
-				CALL_N_LOGONBADHR(m_info->SetEventMask(oldFlags | COR_PRF_MONITOR_ENTERLEAVE));
+	LiveHandle* m_entries;
+	ULONG m_capacity;           // Always a power of 2
+	ULONG m_count;
+};
 
+//============================================================================
+// Hashes 'size' bytes at 'data' to 64 bits.   This is on the hot path of the DuplicateStrings heap walk, 
+// so it consumes 16 bytes at a time with SSE2 (which every x64 machine has), using the multiply-accumulate 
+// step of XXH3, and then mixes down the two lanes.  
+static ULONGLONG HashBytes(const BYTE* data, size_t size)
+{
+	const __m128i key = _mm_set_epi32(0x1CAD21F7, 0x2D1B1A6F, 0x7C01812C, (int)0xBE4BA423);
+	__m128i acc = _mm_set_epi64x((long long)0x9E3779B185EBCA87ULL, (long long)(0xC2B2AE3D27D4EB4FULL ^ size));
 
-				if ((keywords & CallSampledKeyword) != 0)
-					CallSamplingRate = 997;		// TODO make it configurable.    We choose 997 because it is prime and thus likely to be uncorrelated with things.  
-			}
+	BYTE tail[16];
+	for (size_t offset = 0; offset < size; offset += 16)
+	{
+		__m128i value;
+		if (size - offset >= 16)
+			value = _mm_loadu_si128((const __m128i*)(data + offset));
+		else
+		{
+			memset(tail, 0, sizeof(tail));
+			memcpy_s(tail, sizeof(tail), data + offset, size - offset);
+			value = _mm_loadu_si128((const __m128i*)tail);
 		}
+		__m128i valueKey = _mm_xor_si128(value, key);
+		__m128i product = _mm_mul_epu32(valueKey, _mm_shuffle_epi32(valueKey, _MM_SHUFFLE(0, 3, 0, 1)));
+		acc = _mm_add_epi64(acc, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2)));
+		acc = _mm_add_epi64(acc, product);
 	}
-exit:
-	LOG_TRACE(L"Initialize() returns %x\n", hr);
-	return hr;
+
+	ULONGLONG lanes[2];
+	_mm_storeu_si128((__m128i*)lanes, acc);
+	ULONGLONG hash = lanes[0] ^ (lanes[1] * 0x9E3779B97F4A7C15ULL);
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+	return hash;
 }
 
-//==============================================================================
-// This routine does the work of responding to a ETW request from the controller 
-void CorProfilerTracer::DoETWCommand(ULONG IsEnabled, UCHAR Level, ULONGLONG MatchAnyKeywords, struct _EVENT_FILTER_DESCRIPTOR* filterData)
+//============================================================================
+// CallCountTable is a per thread hash table from FunctionID to the number of calls to it, used by the 
+// CallCount keyword.   The CallGraph keyword uses it to count sampled calls by caller and callee instead, the 
+// JitInlining keyword uses it to count the times the JIT inlined a callee into a caller, and the Transitions keyword 
+// uses it to count transitions by method and kind (and to add up the time P/Invokes spent in native code).  
+// Only the owning thread adds to it, so counting a call needs no locks or interlocked 
+// operations.  Other threads only read it (to log the counts), and m_lock keeps them from doing that while 
+// the owner is replacing the entries with a bigger array. 
+class CallCountTable
 {
-	UNREFERENCED_PARAMETER(Level);
-	UNREFERENCED_PARAMETER(filterData);
-
-	LOG_TRACE(L"DoETWCommand(IsEnabled=%d, Level=%d Keywords=0x%x,%x)\n", IsEnabled, Level, (int)(MatchAnyKeywords >> 32), (int)MatchAnyKeywords);
+public:
+	struct Entry
+	{
+		FunctionID ID;			// 0 means this is an unused entry
+		FunctionID Caller;		// Always 0 for CallCount (for JitInlining, the method the callee was inlined into, for Transitions, the TransitionKind)
+		ULONGLONG Count;
+	};
 
-	const DWORD FLAGS_CAN_SET = (COR_PRF_MONITOR_OBJECT_ALLOCATED | COR_PRF_MONITOR_MODULE_LOADS | COR_PRF_MONITOR_GC);
-	DWORD oldFlags = 0;
-	m_info->GetEventMask(&oldFlags);
-	DWORD newFlags = oldFlags;
+	CallCountTable() : Generation(0), m_capacity(256), m_count(0)
+	{
+		InitializeCriticalSection(&m_lock);
+		m_entries = new Entry[m_capacity];
+		memset(m_entries, 0, m_capacity * sizeof(Entry));
+	}
+	~CallCountTable() { delete[] m_entries; DeleteCriticalSection(&m_lock); }
 
-	if (IsEnabled == EVENT_CONTROL_CODE_ENABLE_PROVIDER)
+	// Only called by the thread that owns the table.  
+	void Increment(FunctionID functionId, FunctionID caller = 0, ULONGLONG amount = 1)
 	{
-#if 0 // TODO FIX NOW, implement filtering.   
-		if (filterData != NULL)
+		ULONG idx = Find(m_entries, m_capacity, functionId, caller);
+		if (m_entries[idx].ID == 0)
 		{
-			if (filterData->Ptr != NULL && filterData->Size > 0)
+			if ((m_count + 1) * 2 > m_capacity)
 			{
-				byte* ptr = (byte*)filterData->Ptr;
-
+				Grow();
+				idx = Find(m_entries, m_capacity, functionId, caller);
 			}
+			m_entries[idx].ID = functionId;
+			m_entries[idx].Caller = caller;
+			m_count++;
 		}
-#endif 
-
-		m_currentKeywords = MatchAnyKeywords;
+		m_entries[idx].Count += amount;
+	}
 
-		// Depending on what we asked for in the Keywords, turn on the cooresponding Profiler callbacks.  
-		newFlags = (oldFlags & ~FLAGS_CAN_SET);
-		newFlags |= COR_PRF_MONITOR_MODULE_LOADS;
+	// Forgets the counts, which are from before CallCountGeneration changed to 'generation'.  Only called by the 
+	// thread that owns the table.  
+	void Clear(LONG generation)
+	{
+		EnterCriticalSection(&m_lock);
+		memset(m_entries, 0, m_capacity * sizeof(Entry));
+		m_count = 0;
+		Generation = generation;
+		LeaveCriticalSection(&m_lock);
+	}
 
-		if ((MatchAnyKeywords & (GCKeyword | GCAllocKeyword | GCAllocSampledKeyword | GCHeapKeyword)))
-			newFlags |= COR_PRF_MONITOR_GC;
-		if ((MatchAnyKeywords & (GCAllocKeyword | GCAllocSampledKeyword)) != 0 && m_profilerLoadedAtStartup)
+	// Adds the counts in this table to 'totals'.  Can be called from any thread.  
+	void AddTo(std::unordered_map<FunctionID, ULONGLONG>& totals)
+	{
+		EnterCriticalSection(&m_lock);
+		for (ULONG i = 0; i < m_capacity; i++)
 		{
-			newFlags |= COR_PRF_MONITOR_OBJECT_ALLOCATED;
-			if ((MatchAnyKeywords & GCAllocSampledKeyword) != 0)
-				m_smartSampling = true;
+			const Entry& entry = m_entries[i];
+			if (entry.ID != 0 && entry.Count != 0)
+				totals[entry.ID] += entry.Count;
 		}
-		if ((MatchAnyKeywords & CallKeyword) != 0 && m_profilerLoadedAtStartup)
-			newFlags |= COR_PRF_MONITOR_ENTERLEAVE;
+		LeaveCriticalSection(&m_lock);
+	}
 
-		// We send the manifest on Provider startup.   
-		if (MatchAnyKeywords != 0 && !m_sentManifest)
+	// Adds the counts in this table to 'totals', which is indexed by (caller, callee).  Can be called from any thread.  
+	void AddEdgesTo(std::map<std::pair<FunctionID, FunctionID>, ULONGLONG>& totals)
+	{
+		EnterCriticalSection(&m_lock);
+		for (ULONG i = 0; i < m_capacity; i++)
 		{
-#if 0 
-			LOG_TRACE(L"Sending Manifest\n");
-			EventWriteSendManifestEvent(1, 1, 0, 0x5B, 1, 0, "<instrumentationManifest/>"); THis is not right, it is not null terminated.
-				m_sentManifest = true;
-#endif 
+			const Entry& entry = m_entries[i];
+			if (entry.ID != 0 && entry.Count != 0)
+				totals[std::make_pair(entry.Caller, entry.ID)] += entry.Count;
 		}
+		LeaveCriticalSection(&m_lock);
 	}
-	else if (IsEnabled == EVENT_CONTROL_CODE_CAPTURE_STATE)
+
+	LONG Generation;			// For CallCount, the CallCountGeneration the counts are from
+
+private:
+	static ULONG Find(const Entry* entries, ULONG capacity, FunctionID functionId, FunctionID caller)
 	{
-		EventWriteCaptureStateStart();
+		ULONGLONG key = ((ULONGLONG)functionId >> 3) ^ ((ULONGLONG)caller * 0xC2B2AE3D27D4EB4FULL);
+		ULONG idx = (ULONG)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (capacity - 1);
+		while (entries[idx].ID != 0 && (entries[idx].ID != functionId || entries[idx].Caller != caller))
+			idx = (idx + 1) & (capacity - 1);
+		return idx;
+	}
 
-		// You send the manifest if you don't ask for any other type of rundown or you asked for every other type of rundown.
-		if (MatchAnyKeywords == 0 || MatchAnyKeywords == 0xFFFFFFFFFFFFFFFF)
+	void Grow()
+	{
+		ULONG newCapacity = m_capacity * 2;
+		Entry* newEntries = new Entry[newCapacity];
+		memset(newEntries, 0, newCapacity * sizeof(Entry));
+		for (ULONG i = 0; i < m_capacity; i++)
 		{
-#if 0 
-			LOG_TRACE(L"Sending Manifest\n");
-			EventWriteSendManifestEvent(1, 1, 0, 0x5B, 1, 0, "<instrumentationManifest/>"); THis is not right, it is not null terminated.
-#endif 
+			if (m_entries[i].ID != 0)
+				newEntries[Find(newEntries, newCapacity, m_entries[i].ID, m_entries[i].Caller)] = m_entries[i];
 		}
-		if ((MatchAnyKeywords & GCHeapKeyword) != 0)
+
+		EnterCriticalSection(&m_lock);
+		Entry* oldEntries = m_entries;
+		m_entries = newEntries;
+		m_capacity = newCapacity;
+		LeaveCriticalSection(&m_lock);
+		delete[] oldEntries;
+	}
+
+	CRITICAL_SECTION m_lock;
+	Entry* m_entries;
+	ULONG m_capacity;           // Always a power of 2
+	ULONG m_count;
+};
+
+//============================================================================
+// CallTree is a per thread calling context tree used by the CallTree keyword.  There is a node for every 
+// distinct call path (so a method called from two places has two nodes) with the calls, inclusive and exclusive 
+// time of that path.  The shadow stack of the methods the thread is in lets us find the node for the next call
+// and charge the time when they return.   Like CallCountTable, only the owning thread changes it, and 
+// m_lock keeps other threads (who are merging the trees) from reading the nodes while we add one. 
+class CallTree
+{
+public:
+	struct Node
+	{
+		FunctionID ID;
+		ULONG Parent;				// Always less than this node's index (node 0 is the root)
+		ULONG FirstChild;			// 0 means none
+		ULONG NextSibling;			// 0 means none
+		ULONGLONG Calls;
+		ULONGLONG InclusiveTicks;
+		ULONGLONG ExclusiveTicks;
+	};
+
+	CallTree() : m_generation(0)
+	{
+		InitializeCriticalSection(&m_lock);
+		Node root = {};
+		m_nodes.reserve(256);
+		m_nodes.push_back(root);
+		m_stack.reserve(64);
+	}
+	~CallTree() { DeleteCriticalSection(&m_lock); }
+
+	// Only called by the thread that owns the tree.  'generation' changes each time CallTree is turned on, 
+	// and the methods we were in before that will never tell us they returned, so we forget them.  
+	void Enter(FunctionID functionId, ULONGLONG now, LONG generation)
+	{
+		if (m_generation != generation)
 		{
-			LOG_TRACE(L"Forcing GC\n");
-			ForceGC();
-			LOG_TRACE(L"Done Forcing GC\n");
+			m_stack.clear();
+			m_generation = generation;
 		}
-		if ((MatchAnyKeywords & GCKeyword) != 0)
+
+		ULONG parent = m_stack.empty() ? 0 : m_stack.back().NodeIndex;
+		ULONG node = FindChild(parent, functionId);
+		m_nodes[node].Calls++;
+		Frame frame = { node, now, 0 };
+		m_stack.push_back(frame);
+	}
+
+	// Only called by the thread that owns the tree.  The method that returns is normally the one on the top 
+	// of the stack, but if it is not (we missed a leave), we pop everything above it too.  If it is not on 
+	// the stack at all, we never saw it called (e.g. it was called before CallTree was turned on), so we ignore it. 
+	// Like Enter, we forget the stack if CallTree has been turned on again since we last saw it.  
+	void Leave(FunctionID functionId, ULONGLONG now, LONG generation)
+	{
+		if (m_generation != generation)
 		{
-			LOG_TRACE(L"Dumping Class Information\n");
-			DumpClassInfo();
-			LOG_TRACE(L"Dumping Class Information\n");
+			m_stack.clear();
+			m_generation = generation;
+			return;
 		}
 
-		// Indicate that we are done with capture state processing
-		EventWriteCaptureStateStop();
+		size_t depth = m_stack.size();
+		while (depth > 0 && m_nodes[m_stack[depth - 1].NodeIndex].ID != functionId)
+			--depth;
+		if (depth == 0)
+			return;
+		while (m_stack.size() >= depth)
+			Pop(now);
+	}
 
-		// Detach is special, we do it after logging we are done with CaptureState activity (Because we could start tearing down)
-		if ((MatchAnyKeywords & DetachKeyword) != 0 && !m_profilerLoadedAtStartup && !m_detaching)
+	// Adds this tree to 'merged' (whose node 0 is the root) using 'index' to find the merged node for a 
+	// (merged parent, FunctionID) pair.  Can be called from any thread.  
+	void AddTo(std::vector<Node>& merged, std::map<std::pair<ULONG, FunctionID>, ULONG>& index)
+	{
+		EnterCriticalSection(&m_lock);
+		std::vector<ULONG> mergedIdx(m_nodes.size());
+		mergedIdx[0] = 0;
+		for (size_t i = 1; i < m_nodes.size(); i++)
 		{
-			m_detaching = true;
-			LOG_TRACE(L"Detaching\n");
-			HRESULT hr = m_info->RequestProfilerDetach(1000);
-			LOG_TRACE(L"Done Detaching Detaching ret = 0x%x\n", hr);
-			if (hr != S_OK)
-				EventWriteProfilerError(hr, L"Request Profiler Detach Failed");
+			const Node& node = m_nodes[i];
+			ULONG parent = mergedIdx[node.Parent];
+			auto key = std::make_pair(parent, node.ID);
+			auto it = index.find(key);
+			if (it == index.end())
+			{
+				Node newNode = { node.ID, parent, 0, 0, 0, 0, 0 };
+				it = index.insert(std::make_pair(key, (ULONG)merged.size())).first;
+				merged.push_back(newNode);
+			}
+			Node& mergedNode = merged[it->second];
+			mergedNode.Calls += node.Calls;
+			mergedNode.InclusiveTicks += node.InclusiveTicks;
+			mergedNode.ExclusiveTicks += node.ExclusiveTicks;
+			mergedIdx[i] = it->second;
 		}
+		LeaveCriticalSection(&m_lock);
 	}
-	else    // (IsEnabled == EVENT_CONTROL_CODE_DISABLE_PROVIDER)   
+
+	// Adds the nodes of 'other' (the tree of a thread that died) to this tree.  Only called (by ThreadDestroyed) for 
+	// the tree of the threads that died, which has no owning thread and is protected by the tracer's m_callCountLock.  
+	void AddTree(const CallTree& other)
 	{
-		ClearTables();
-		m_sentManifest = 0;
-		// We reset all flags on disable. 
-		newFlags = (oldFlags & ~FLAGS_CAN_SET);
-		m_currentKeywords = 0;
+		std::vector<ULONG> mergedIdx(other.m_nodes.size());
+		mergedIdx[0] = 0;
+		for (size_t i = 1; i < other.m_nodes.size(); i++)
+		{
+			const Node& node = other.m_nodes[i];
+			ULONG idx = FindChild(mergedIdx[node.Parent], node.ID);
+			m_nodes[idx].Calls += node.Calls;
+			m_nodes[idx].InclusiveTicks += node.InclusiveTicks;
+			m_nodes[idx].ExclusiveTicks += node.ExclusiveTicks;
+			mergedIdx[i] = idx;
+		}
 	}
 
-	// If we updated the profiler flags, actually send the update to the profiler.  
-	if (newFlags != oldFlags && !m_detaching)
+private:
+	struct Frame
 	{
-		HRESULT hr = m_info->SetEventMask(newFlags);
-		LOG_TRACE(L"DoETWCommand SetEventMask 0x%x returning 0x%x\n", newFlags, hr);
-		if (hr != S_OK)
-			EventWriteProfilerError(hr, L"Profiler SetEventMask Failed");
+		ULONG NodeIndex;
+		ULONGLONG EnterTicks;
+		ULONGLONG ChildTicks;		// The inclusive time of the calls this frame made.  
+	};
+
+	void Pop(ULONGLONG now)
+	{
+		Frame frame = m_stack.back();
+		m_stack.pop_back();
+		ULONGLONG elapsed = now - frame.EnterTicks;
+		Node& node = m_nodes[frame.NodeIndex];
+		node.InclusiveTicks += elapsed;
+		node.ExclusiveTicks += elapsed - min(frame.ChildTicks, elapsed);
+		if (!m_stack.empty())
+			m_stack.back().ChildTicks += elapsed;
 	}
-}
 
-//==============================================================================
-// The constuctor does almost nothing, the real action happens
-// in initialize (where we have a ProfilerInfo to call back to
-// the runtime with)
-CorProfilerTracer::CorProfilerTracer()
-{
-#if DEBUG
-	// We put the log in the temp directory in a file called ETWClrProfiler.log
-	wchar_t logFilePath[MAX_PATH];
-	GetEnvironmentVariableW(L"Temp", logFilePath, MAX_PATH);
-	wcscat_s(logFilePath, MAX_PATH, L"\\ETWClrProfiler.log");
+	ULONG FindChild(ULONG parent, FunctionID functionId)
+	{
+		for (ULONG child = m_nodes[parent].FirstChild; child != 0; child = m_nodes[child].NextSibling)
+		{
+			if (m_nodes[child].ID == functionId)
+				return child;
+		}
 
-	// the convention is that if the file exists, then we write to it, otherwise we do nothing.  
-	DWORD attr = GetFileAttributesW(logFilePath);
-	if (attr != INVALID_FILE_ATTRIBUTES)
-		OPEN_LOG(TRACE_LOGGER, logFilePath);
-#endif 
+		Node node = { functionId, parent, 0, m_nodes[parent].FirstChild, 0, 0, 0 };
+		ULONG idx = (ULONG)m_nodes.size();
+		EnterCriticalSection(&m_lock);
+		m_nodes.push_back(node);
+		m_nodes[parent].FirstChild = idx;
+		LeaveCriticalSection(&m_lock);
+		return idx;
+	}
 
-	LOG_TRACE(L"Creating new CorProfilerInstance\n");
-	m_refCount = 0;
-	m_info = NULL;
-	m_gcCount = 0;
-	m_curAllocSize = 0;
-	m_smartSampling = false;
-	m_forcingGC = false;
+	CRITICAL_SECTION m_lock;
+	std::vector<Node> m_nodes;
+	std::vector<Frame> m_stack;
+	LONG m_generation;
+};
+
+//============================================================================
+// The distinct call stacks (FunctionIDs, innermost first) we have logged, so that each sample only needs 
+// to log a small stack ID.  The frames of all the stacks are kept end to end in one vector.  Can be used 
+// from any thread.  
+class StackTable
+{
+public:
+	StackTable()
+	{
+		InitializeCriticalSection(&m_lock);
+		m_frames.reserve(4096);
+		m_starts.push_back(0);
+	}
+	~StackTable() { DeleteCriticalSection(&m_lock); }
+
+	// Returns the ID (starting at 1) of the stack 'frames', and sets *isNew if we had not seen it before.  
+	ULONG Intern(const ULONGLONG* frames, ULONG count, bool* isNew)
+	{
+		ULONGLONG hash = HashBytes((const BYTE*)frames, count * sizeof(ULONGLONG));
+		EnterCriticalSection(&m_lock);
+		ULONG stackId = 0;
+		auto range = m_index.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			ULONG start = m_starts[it->second - 1];
+			if (m_starts[it->second] - start == count && memcmp(&m_frames[start], frames, count * sizeof(ULONGLONG)) == 0)
+			{
+				stackId = it->second;
+				break;
+			}
+		}
+		*isNew = (stackId == 0);
+		if (stackId == 0)
+		{
+			m_frames.insert(m_frames.end(), frames, frames + count);
+			m_starts.push_back((ULONG)m_frames.size());
+			stackId = (ULONG)m_starts.size() - 1;
+			m_index.insert(std::make_pair(hash, stackId));
+		}
+		LeaveCriticalSection(&m_lock);
+		return stackId;
+	}
+
+	void Clear()
+	{
+		EnterCriticalSection(&m_lock);
+		m_index.clear();
+		m_frames.clear();
+		m_starts.resize(1);
+		LeaveCriticalSection(&m_lock);
+	}
+
+private:
+	CRITICAL_SECTION m_lock;
+	std::unordered_multimap<ULONGLONG, ULONG> m_index;		// Hash of the frames to stack ID
+	std::vector<ULONGLONG> m_frames;
+	std::vector<ULONG> m_starts;							// Stack N's frames are m_frames[m_starts[N-1]] up to m_frames[m_starts[N]]
+};
+
+//============================================================================
+// Writes a perf map file, which has a '<start> <size> <name>' line (in hex) for each piece of JIT compiled code.  
+// It is how perf and other native profilers that know nothing about the runtime find the names of JIT compiled code.  
+// Add is called on the threads that JIT compile, so it only appends the line to a buffer, and a thread of our own 
+// writes the buffer to the file every PerfMapFlushMSec.  
+class PerfMapWriter
+{
+public:
+	PerfMapWriter() : m_file(INVALID_HANDLE_VALUE), m_thread(NULL), m_stopEvent(NULL)
+	{
+		InitializeCriticalSection(&m_lock);
+	}
+	~PerfMapWriter() { Stop(); DeleteCriticalSection(&m_lock); }
+
+	bool IsStarted() { return m_thread != NULL; }
+
+	// Creates (or truncates) the file 'path' and starts the writer thread.  Returns the error if it fails.  
+	HRESULT Start(const wchar_t* path)
+	{
+		if (m_thread != NULL)
+			return S_OK;
+		HANDLE file = CreateFileW(path, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return HRESULT_FROM_WIN32(GetLastError());
+		EnterCriticalSection(&m_lock);
+		m_file = file;
+		LeaveCriticalSection(&m_lock);
+		m_stopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+		if (m_stopEvent != NULL)
+			m_thread = CreateThread(NULL, 0, WriterThreadProc, this, 0, NULL);
+		if (m_thread == NULL)
+		{
+			HRESULT hr = HRESULT_FROM_WIN32(GetLastError());		// Before Stop changes it
+			Stop();
+			return hr;
+		}
+		return S_OK;
+	}
+
+	// Writes the lines we have not written yet and closes the file.  
+	void Stop()
+	{
+		if (m_thread != NULL)
+		{
+			SetEvent(m_stopEvent);
+			WaitForSingleObject(m_thread, INFINITE);
+			CloseHandle(m_thread);
+			m_thread = NULL;
+		}
+		if (m_stopEvent != NULL)
+		{
+			CloseHandle(m_stopEvent);
+			m_stopEvent = NULL;
+		}
+		EnterCriticalSection(&m_lock);
+		HANDLE file = m_file;
+		m_file = INVALID_HANDLE_VALUE;
+		m_pending.clear();
+		LeaveCriticalSection(&m_lock);
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+	}
+
+	// Can be called from any thread.  Does nothing if we are not started.  
+	void Add(UINT_PTR start, SIZE_T size, const wchar_t* name)
+	{
+		char line[64 + MethodNameMaxChars * 3];		// A UTF8 character is at most 3 bytes for every UTF16 one
+		int length = sprintf_s(line, _countof(line), "%llx %llx ", (ULONGLONG)start, (ULONGLONG)size);
+		if (length <= 0)
+			return;
+		int nameLength = WideCharToMultiByte(CP_UTF8, 0, name, -1, line + length, (int)_countof(line) - length - 1, NULL, NULL);
+		if (nameLength <= 0)
+			return;
+		length += nameLength - 1;		// nameLength includes the terminating null
+		line[length++] = '\n';
+
+		EnterCriticalSection(&m_lock);
+		if (m_file != INVALID_HANDLE_VALUE)
+			m_pending.insert(m_pending.end(), line, line + length);
+		LeaveCriticalSection(&m_lock);
+	}
+
+private:
+	static DWORD WINAPI WriterThreadProc(LPVOID context)
+	{
+		PerfMapWriter* writer = (PerfMapWriter*)context;
+		std::vector<char> writing;
+		for (;;)
+		{
+			bool stopping = WaitForSingleObject(writer->m_stopEvent, PerfMapFlushMSec) != WAIT_TIMEOUT;
+			EnterCriticalSection(&writer->m_lock);
+			writing.swap(writer->m_pending);
+			LeaveCriticalSection(&writer->m_lock);
+			if (!writing.empty())
+			{
+				DWORD written = 0;
+				WriteFile(writer->m_file, writing.data(), (DWORD)writing.size(), &written, NULL);
+				writing.clear();
+			}
+			if (stopping)
+				break;
+		}
+		return 0;
+	}
+
+	CRITICAL_SECTION m_lock;
+	HANDLE m_file;				// Only changes when the writer thread is not running
+	HANDLE m_thread;
+	HANDLE m_stopEvent;
+	std::vector<char> m_pending;	// The lines the writer thread has not written yet (protected by m_lock)
+};
+
+//============================================================================
+// StartupThreadLog is the assembly, module and class loads and JIT compilations one thread did during startup, 
+// used by the StartupTimeline keyword.  The activities nest (e.g. a JIT compilation loads classes), so we keep a 
+// stack of the ones in progress and each one that finishes remembers its time less the time of the ones nested 
+// in it (its exclusive time).  Only the owning thread adds to it, and m_lock keeps other threads from reading 
+// the intervals while the owner is adding one.  
+enum StartupActivity { StartupAssemblyLoad, StartupModuleLoad, StartupClassLoad, StartupJit, StartupActivityCount };
+
+class StartupThreadLog
+{
+public:
+	struct Interval
+	{
+		ULONGLONG ID;				// The AssemblyID, ModuleID, ClassID or FunctionID
+		ULONGLONG StartTicks;
+		ULONGLONG StopTicks;
+		ULONGLONG ExclusiveTicks;
+		BYTE Kind;					// A StartupActivity
+	};
+
+	StartupThreadLog(DWORD threadId) : ThreadID(threadId)
+	{
+		InitializeCriticalSection(&m_lock);
+		m_intervals.reserve(1024);
+		m_stack.reserve(16);
+	}
+	~StartupThreadLog() { DeleteCriticalSection(&m_lock); }
+
+	// Only called by the thread that owns the log.  
+	void Start(BYTE kind, ULONGLONG id, ULONGLONG now)
+	{
+		Frame frame = { kind, id, now, 0 };
+		m_stack.push_back(frame);
+	}
+
+	// Only called by the thread that owns the log.  Normally the activity is on the top of the stack, but if it is 
+	// not (we missed a finish), we drop the ones above it.  If it failed ('succeeded' is false) its ID may not be 
+	// valid, so we don't remember it.  
+	void Stop(BYTE kind, ULONGLONG id, ULONGLONG now, bool succeeded)
+	{
+		size_t depth = m_stack.size();
+		while (depth > 0 && (m_stack[depth - 1].Kind != kind || m_stack[depth - 1].ID != id))
+			--depth;
+		if (depth == 0)
+			return;
+		Frame frame = m_stack[depth - 1];
+		m_stack.resize(depth - 1);
+		ULONGLONG elapsed = now - frame.StartTicks;
+		if (!m_stack.empty())
+			m_stack.back().ChildTicks += elapsed;
+		if (succeeded)
+		{
+			Interval interval = { id, frame.StartTicks, now, elapsed - min(frame.ChildTicks, elapsed), kind };
+			EnterCriticalSection(&m_lock);
+			m_intervals.push_back(interval);
+			LeaveCriticalSection(&m_lock);
+		}
+	}
+
+	// Can be called from any thread.  
+	void CopyIntervals(std::vector<Interval>& intervals)
+	{
+		EnterCriticalSection(&m_lock);
+		intervals.assign(m_intervals.begin(), m_intervals.end());
+		LeaveCriticalSection(&m_lock);
+	}
+
+	const DWORD ThreadID;
+
+private:
+	struct Frame
+	{
+		BYTE Kind;
+		ULONGLONG ID;
+		ULONGLONG StartTicks;
+		ULONGLONG ChildTicks;		// The time of the activities nested in this one.  
+	};
+
+	CRITICAL_SECTION m_lock;
+	std::vector<Interval> m_intervals;
+	std::vector<Frame> m_stack;
+};
+
+//============================================================================
+// The latency histogram of one method that PerfView_MethodLatency selected.  The buckets are log-linear (like 
+// HdrHistogram) so the relative error is the same for short and long latencies.  The selected methods are typically 
+// running on many threads at once so we use interlocked operations to update it.  
+class MethodLatencyHistogram
+{
+public:
+	MethodLatencyHistogram(FunctionID functionId, const wchar_t* name) : ID(functionId), Count(0), SumTicks(0), MaxTicks(0)
+	{
+		size_t nameLength = wcslen(name) + 1;
+		Name = new wchar_t[nameLength];
+		wcscpy_s(Name, nameLength, name);
+		memset((void*)Buckets, 0, sizeof(Buckets));
+	}
+	~MethodLatencyHistogram() { delete[] Name; }
+
+	// Can race with Add (so a few values can be lost), which is fine since we only clear when we are turned off.  
+	void Clear()
+	{
+		memset((void*)Buckets, 0, sizeof(Buckets));
+		Count = 0;
+		SumTicks = 0;
+		MaxTicks = 0;
+	}
+
+	void Add(ULONGLONG ticks)
+	{
+		InterlockedIncrement64(&Buckets[BucketIndex(ticks)]);
+		InterlockedIncrement64(&Count);
+		InterlockedExchangeAdd64(&SumTicks, (LONGLONG)ticks);
+		LONGLONG current = MaxTicks;
+		while ((LONGLONG)ticks > current)
+		{
+			LONGLONG prev = InterlockedCompareExchange64(&MaxTicks, (LONGLONG)ticks, current);
+			if (prev == current)
+				break;
+			current = prev;
+		}
+	}
+
+	// Fills in the index and count of each bucket that is not empty ('indexes' and 'counts' have LatencyBucketCount 
+	// entries) and returns how many there are.  
+	ULONG GetBuckets(unsigned short* indexes, ULONGLONG* counts)
+	{
+		ULONG bucketCount = 0;
+		for (ULONG i = 0; i < LatencyBucketCount; i++)
+		{
+			if (Buckets[i] != 0)
+			{
+				indexes[bucketCount] = (unsigned short)i;
+				counts[bucketCount] = Buckets[i];
+				bucketCount++;
+			}
+		}
+		return bucketCount;
+	}
+
+	// Values below 2^LatencySubBucketBits get a bucket each, after that each power of 2 is split into 2^LatencySubBucketBits buckets.  
+	static ULONG BucketIndex(ULONGLONG ticks)
+	{
+		if (ticks < (1 << LatencySubBucketBits))
+			return (ULONG)ticks;
+		unsigned long msb;
+		if ((ticks >> 32) != 0)
+		{
+			_BitScanReverse(&msb, (unsigned long)(ticks >> 32));
+			msb += 32;
+		}
+		else
+			_BitScanReverse(&msb, (unsigned long)ticks);
+		ULONG subBucket = (ULONG)(ticks >> (msb - LatencySubBucketBits)) & ((1 << LatencySubBucketBits) - 1);
+		return ((msb - LatencySubBucketBits + 1) << LatencySubBucketBits) + subBucket;
+	}
+
+	const FunctionID ID;
+	wchar_t* Name;				// We DO own this pointer (we delete it when we die)
+	volatile LONGLONG Count;
+	volatile LONGLONG SumTicks;
+	volatile LONGLONG MaxTicks;
+	volatile LONGLONG Buckets[LatencyBucketCount];
+};
+
+// For GCPauses, the parts of a runtime suspension we keep a MethodLatencyHistogram of.  
+enum PausePhase { PauseSuspend, PauseGC, PauseResume, PauseTotal, PausePhaseCount };
+
+//============================================================================
+// Returns true if we can use AVX2 (the CPU supports it and the OS saves the YMM registers).   
+static bool CpuHasAvx2()
+{
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	const int OSXSAVE = 1 << 27, AVX = 1 << 28;
+	if ((info[2] & (OSXSAVE | AVX)) != (OSXSAVE | AVX) || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+}
+static const bool s_cpuHasAvx2 = CpuHasAvx2();
+
+//============================================================================
+// Returns the number of zero bytes in 'size' bytes at 'data'.   Each byte of the vector accumulator counts 
+// the zeros in one lane, so we sum it into a 64 bit total (with SAD) every 255 iterations, before it can overflow.  
+static ULONGLONG CountZeroBytesSse2(const BYTE* data, size_t size)
+{
+	const __m128i zero = _mm_setzero_si128();
+	ULONGLONG count = 0;
+	size_t offset = 0;
+	while (size - offset >= 16)
+	{
+		size_t blocks = min((size - offset) / 16, (size_t) 255);
+		__m128i acc = zero;
+		for (size_t i = 0; i < blocks; i++, offset += 16)
+			acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + offset)), zero));
+		__m128i sums = _mm_sad_epu8(acc, zero);
+		count += (ULONG)_mm_cvtsi128_si32(sums) + (ULONG)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+	}
+	for (; offset < size; offset++)
+		count += (data[offset] == 0);
+	return count;
+}
+
+static ULONGLONG CountZeroBytesAvx2(const BYTE* data, size_t size)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	ULONGLONG count = 0;
+	size_t offset = 0;
+	while (size - offset >= 32)
+	{
+		size_t blocks = min((size - offset) / 32, (size_t) 255);
+		__m256i acc = zero;
+		for (size_t i = 0; i < blocks; i++, offset += 32)
+			acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(data + offset)), zero));
+		__m256i sums256 = _mm256_sad_epu8(acc, zero);
+		__m128i sums = _mm_add_epi64(_mm256_castsi256_si128(sums256), _mm256_extracti128_si256(sums256, 1));
+		count += (ULONG)_mm_cvtsi128_si32(sums) + (ULONG)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+	}
+	_mm256_zeroupper();
+	return count + CountZeroBytesSse2(data + offset, size - offset);
+}
+
+// Returns the number of zero bytes at the end of the 'size' bytes at 'data' (after the last non-zero byte).  
+static size_t CountTrailingZeroBytes(const BYTE* data, size_t size)
+{
+	const __m128i zero = _mm_setzero_si128();
+	size_t end = size;
+	for (; end >= 16; end -= 16)
+	{
+		int zeroMask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(data + end - 16)), zero));
+		if (zeroMask != 0xFFFF)
+		{
+			unsigned long lastNonZero;
+			_BitScanReverse(&lastNonZero, ~zeroMask & 0xFFFF);
+			return size - (end - 16 + lastNonZero + 1);
+		}
+	}
+	while (end > 0 && data[end - 1] == 0)
+		--end;
+	return size - end;
+}
+
+//============================================================================
+// Returns the DWORD setting 'name'.   An environment variable of that name wins (it is the only source on 
+// platforms without a registry), then the value under HKLM\Software\Microsoft\.NETFramework (where PerfView 
+// puts its settings), otherwise 'defaultValue'.  
+static DWORD GetPerfViewSetting(const wchar_t* name, DWORD defaultValue)
+{
+	wchar_t envValue[32];
+	DWORD envLength = GetEnvironmentVariableW(name, envValue, _countof(envValue));
+	if (0 < envLength && envLength < _countof(envValue))
+	{
+		wchar_t* end = NULL;
+		DWORD parsed = wcstoul(envValue, &end, 0);
+		if (end != envValue && *end == 0)
+			return parsed;
+	}
+
+	DWORD value = 0;
+	DWORD valueSize = sizeof(value);
+	if (RegGetValue(HKEY_LOCAL_MACHINE, L"Software\\Microsoft\\.NETFramework", name, RRF_RT_DWORD, NULL, &value, &valueSize) != ERROR_SUCCESS)
+		return defaultValue;
+	return value;
+}
+
+//============================================================================
+// Like GetPerfViewSetting, but for a string setting.  Returns false (with an empty 'value') if it is not set.  
+static bool GetPerfViewStringSetting(const wchar_t* name, wchar_t* value, DWORD valueCount)
+{
+	DWORD envLength = GetEnvironmentVariableW(name, value, valueCount);
+	if (0 < envLength && envLength < valueCount)
+		return true;
+
+	DWORD valueSize = valueCount * sizeof(wchar_t);
+	if (RegGetValue(HKEY_LOCAL_MACHINE, L"Software\\Microsoft\\.NETFramework", name, RRF_RT_REG_SZ, NULL, value, &valueSize) == ERROR_SUCCESS && value[0] != 0)
+		return true;
+	value[0] = 0;
+	return false;
+}
+
+//============================================================================
+// Returns true if 'name' matches the pattern from 'pattern' to 'patternEnd', where a '*' in the pattern matches 
+// any number of characters.  Like metadata names, it is case sensitive.  
+static bool WildcardMatch(const wchar_t* pattern, const wchar_t* patternEnd, const wchar_t* name)
+{
+	const wchar_t* star = NULL;
+	const wchar_t* starName = NULL;
+	while (*name != 0)
+	{
+		if (pattern < patternEnd && *pattern == L'*')
+		{
+			star = pattern++;
+			starName = name;
+		}
+		else if (pattern < patternEnd && *pattern == *name)
+		{
+			pattern++;
+			name++;
+		}
+		else if (star != NULL)
+		{
+			pattern = star + 1;
+			name = ++starName;
+		}
+		else
+			return false;
+	}
+	while (pattern < patternEnd && *pattern == L'*')
+		pattern++;
+	return pattern == patternEnd;
+}
+
+//============================================================================
+// ETW controllers (e.g. TraceEvent's TraceEventProviderOptions) pass arguments to the provider as filter data that 
+// is a list of null terminated key and value strings.  If 'key' is there with a number as its value, set *value and return true. 
+static bool GetFilterDataValue(const EVENT_FILTER_DESCRIPTOR* filterData, const char* key, DWORD* value)
+{
+	if (filterData == NULL || filterData->Ptr == 0 || filterData->Size == 0)
+		return false;
+
+	const char* ptr = (const char*)filterData->Ptr;
+	const char* end = ptr + filterData->Size;
+	while (ptr < end)
+	{
+		const char* keyEnd = (const char*)memchr(ptr, 0, end - ptr);
+		if (keyEnd == NULL || keyEnd + 1 >= end)
+			return false;
+		const char* valueStr = keyEnd + 1;
+		const char* valueEnd = (const char*)memchr(valueStr, 0, end - valueStr);
+		if (valueEnd == NULL)
+			return false;
+
+		if (strcmp(ptr, key) == 0)
+		{
+			char* parsedEnd = NULL;
+			DWORD parsed = strtoul(valueStr, &parsedEnd, 0);
+			if (parsedEnd == valueStr || *parsedEnd != 0)
+				return false;
+			*value = parsed;
+			return true;
+		}
+		ptr = valueEnd + 1;
+	}
+	return false;
+}
+
+//============================================================================
+// We registered this in ::Initialize to be invoked when there are ETW commands
+// It just forwards to DoETWCommand
+void WINAPI ProfilerControlCallback(
+	LPCGUID SourceId,
+	ULONG IsEnabled,
+	UCHAR Level,
+	ULONGLONG MatchAnyKeywords,
+	ULONGLONG MatchAllKeywords,
+	PEVENT_FILTER_DESCRIPTOR FilterData,
+	PVOID CallbackContext)
+{
+	UNREFERENCED_PARAMETER(SourceId);
+	UNREFERENCED_PARAMETER(MatchAllKeywords);
+
+	CorProfilerTracer* profiler = (CorProfilerTracer*)CallbackContext;
+	LOG_TRACE(L"ProfilerControlCallback DoETWCommand IsEnabled 0x%x Level 0x%xI64 MatchAny 0x%x\n", IsEnabled, Level, MatchAnyKeywords);
+	profiler->DoETWCommand(IsEnabled, Level, MatchAnyKeywords, FilterData);
+}
+
+//==============================================================================
+// Used for call count profiling
+
+// The hooks need the tracer to register the per thread call count tables.  
+static CorProfilerTracer* s_tracer = NULL;
+
+//************************
+// The countdown is per thread so that the hooks don't make every core fight over one cache line.  The naked
+// hooks can't use the compiler's TLS access, so they find it using its offset from the start of the thread's TLS block. 
+EXTERN_C __declspec(thread) int CallSampleCount = 0;	// This counts down to 0 for sampling 
+EXTERN_C ULONG_PTR CallSampleCountTlsOffset = 0;		// The offset of CallSampleCount in the TLS block 
+EXTERN_C ULONG _tls_index;								// Set by the loader, the index of our TLS block 
+EXTERN_C int CallSamplingEnabled = 0;	// The hooks are always installed (if we were loaded at startup), but do nothing unless this is set. 
+int CallSamplingRate = 1;			// The number of calls to skip before taking a sample.  
+
+// When we are counting every call (CallCount), the hooks call EnterMethod for every call, and EnterMethod 
+// does its own sampling for the CallEnter events.  CallCountGeneration changes each time CallCount is turned on.  
+int CallCountingEnabled = 0;
+LONG CallCountGeneration = 0;
+int CallEventRate = 1;				// EnterMethod takes a sample (CallEnter event, CallGraph edge or CallStacks stack) 1 in this many times (0 means never).  
+int CallEnterEventsEnabled = 0;
+static __declspec(thread) int CallEventCount = 0;
+static __declspec(thread) CallCountTable* CallCounts = NULL;
+
+// We log a FunctionIDDefinition the first time we log a FunctionID.  Each thread remembers the last few it 
+// checked so that logging a CallEnter event rarely needs the tracer's lock.  ClearTables forgets what we 
+// logged, so it changes FunctionInfoGeneration to tell the threads to forget too.  
+LONG FunctionInfoGeneration = 0;
+static __declspec(thread) FunctionID DefinedFunctions[DefinedFunctionCacheSize];
+static __declspec(thread) LONG DefinedFunctionsGeneration = 0;
+
+static void DefineFunction(FunctionID functionID)
+{
+	if (DefinedFunctionsGeneration != FunctionInfoGeneration)
+	{
+		memset(DefinedFunctions, 0, sizeof(DefinedFunctions));
+		DefinedFunctionsGeneration = FunctionInfoGeneration;
+	}
+	FunctionID& defined = DefinedFunctions[(functionID >> 3) & (DefinedFunctionCacheSize - 1)];
+	if (defined != functionID)
+	{
+		ULONGLONG functionId = functionID;
+		s_tracer->DefineFunctions(&functionId, 1);
+		defined = functionID;
+	}
+}
+
+// For CallGraph, each sample also counts the edge from the caller to the callee (in a per thread table, like CallCount).  
+int CallGraphEnabled = 0;
+static __declspec(thread) CallCountTable* CallEdges = NULL;
+
+// The leave hooks (which are only installed if CallTree was asked for or PerfView_MethodLatency was set at startup) 
+// call LeaveMethod when this is set.  
+EXTERN_C int CallLeaveEnabled = 0;
+
+// For CallTree.  CallTreeGeneration changes each time it is turned on.  
+int CallTreeEnabled = 0;
+LONG CallTreeGeneration = 0;
+static __declspec(thread) CallTree* CallTreeStack = NULL;
+
+// For MethodLatency.  The function ID mapper gives only the methods PerfView_MethodLatency selects hooks, and adds 
+// them to MethodLatencyTable, a hash table from FunctionID to histogram that the hooks read without locking.  
+// Each thread has a small stack of the selected methods it is in and when it entered them.  
+int MethodLatencyEnabled = 0;
+LONG MethodLatencyGeneration = 0;
+static MethodLatencyHistogram* volatile MethodLatencyTable[MethodLatencyMaxMethods * 2];
+struct LatencyFrame
+{
+	FunctionID ID;
+	ULONGLONG EnterTicks;
+};
+static __declspec(thread) LatencyFrame LatencyStack[MethodLatencyMaxDepth];
+static __declspec(thread) int LatencyDepth = 0;			// Can be more than MethodLatencyMaxDepth (those frames are not timed)
+static __declspec(thread) LONG LatencyStackGeneration = 0;
+
+static ULONG MethodLatencySlot(FunctionID functionId)
+{
+	return (ULONG)((((ULONGLONG)functionId >> 3) * 0x9E3779B97F4A7C15ULL) >> 32) & (_countof(MethodLatencyTable) - 1);
+}
+
+// The table is never more than half full, so there is always an empty slot to stop the search.  
+static MethodLatencyHistogram* FindMethodLatency(FunctionID functionId)
+{
+	for (ULONG idx = MethodLatencySlot(functionId);; idx = (idx + 1) & (_countof(MethodLatencyTable) - 1))
+	{
+		MethodLatencyHistogram* histogram = MethodLatencyTable[idx];
+		if (histogram == NULL || histogram->ID == functionId)
+			return histogram;
+	}
+}
+
+// For JitLatency (see JITCompilationStarted), changes each time it is turned on.  
+static LONG JitLatencyGeneration = 0;
+
+// For Transitions (see ManagedToUnmanagedTransition), changes each time it is turned on.  
+static LONG TransitionGeneration = 0;
+
+// For CallScoped.  The function ID mapper tags the client IDs of the anchor methods (PerfView_CallScopeAnchors) with 
+// the low bit (FunctionIDs are aligned) so that the naked hooks can spot them without a lookup, and always call EnterMethod 
+// and LeaveMethod for them.   While a thread has no anchor on its stack, EnterMethod sets its CallSampleCount to 
+// CallScopeIdleCount so the hooks leave it alone.  CallScopeAnchors is the set of anchors (for the exception unwind
+// callbacks, whose FunctionIDs are not tagged).  
+#define CallScopeAnchorTag 1
+int CallScopeEnabled = 0;
+LONG CallScopeGeneration = 0;
+static FunctionID volatile CallScopeAnchors[CallScopeMaxAnchors * 2];
+static __declspec(thread) int CallScopeDepth = 0;			// The number of anchors on this thread's stack
+static __declspec(thread) LONG CallScopeThreadGeneration = 0;
+
+static ULONG CallScopeAnchorSlot(FunctionID functionId)
+{
+	return (ULONG)((((ULONGLONG)functionId >> 3) * 0x9E3779B97F4A7C15ULL) >> 32) & (_countof(CallScopeAnchors) - 1);
+}
+
+static bool IsCallScopeAnchor(FunctionID functionId)
+{
+	for (ULONG idx = CallScopeAnchorSlot(functionId);; idx = (idx + 1) & (_countof(CallScopeAnchors) - 1))
+	{
+		FunctionID anchor = CallScopeAnchors[idx];
+		if (anchor == 0 || anchor == functionId)
+			return anchor != 0;
+	}
+}
+
+// For CallStacks.  Each sample logs the stack of managed methods it was called from.  Looking up the method a return 
+// address is in is the expensive part, so each thread has a direct mapped cache of the return addresses it has 
+// looked up.  Methods can be unloaded (and their code reused), so the caches are forgotten when FunctionInfoGeneration changes.  
+struct FrameCacheEntry
+{
+	UINT_PTR IP;
+	FunctionID ID;				// 0 if IP is not managed code
+};
+int CallStacksEnabled = 0;
+static __declspec(thread) FrameCacheEntry* FrameCache = NULL;
+static __declspec(thread) LONG FrameCacheGeneration = 0;
+
+static FunctionID GetFrameFunction(UINT_PTR ip)
+{
+	if (FrameCache == NULL)
+		FrameCache = s_tracer->NewFrameCache();
+	if (FrameCacheGeneration != FunctionInfoGeneration)
+	{
+		memset(FrameCache, 0, FrameCacheSize * sizeof(FrameCacheEntry));
+		FrameCacheGeneration = FunctionInfoGeneration;
+	}
+	FrameCacheEntry& entry = FrameCache[(ULONG)((((ULONGLONG)ip) * 0x9E3779B97F4A7C15ULL) >> 32) & (FrameCacheSize - 1)];
+	if (entry.IP != ip)
+	{
+		FunctionID functionId = 0;
+		if (!s_tracer->GetFunctionFromIP(ip, &functionId))
+			functionId = 0;
+		entry.IP = ip;
+		entry.ID = functionId;
+	}
+	return entry.ID;
+}
+
+//************************
+// Fills in 'frames' with the methods on the stack, starting with the method whose enter hook we are in, followed 
+// by its caller and so on, and returns how many there are (at most 'maxFrames').  
+// On X86 we walk the EBP chain from the frame the naked hook passes us.  Native code need not have EBP frames, 
+// so we stop at the first return address that is not managed code, and we only follow frames that are on this 
+// thread's stack and above the last one.  On X64 managed code does not keep a frame pointer chain, so we let the 
+// OS unwind (using the unwind information the JIT registers) and skip the frames that are not managed.  
+static __declspec(noinline) ULONG CaptureCallStack(FunctionID functionID, UINT_PTR framePointer, ULONGLONG* frames, ULONG maxFrames)
+{
+	ULONG count = 0;
+	frames[count++] = functionID;
+#if defined(_M_IX86)
+	NT_TIB* tib = (NT_TIB*)NtCurrentTeb();
+	UINT_PTR stackLimit = (UINT_PTR)tib->StackLimit;
+	UINT_PTR stackBase = (UINT_PTR)tib->StackBase;
+	UINT_PTR frame = framePointer;
+	while (count < maxFrames && stackLimit <= frame && frame + 2 * sizeof(UINT_PTR) <= stackBase && (frame & (sizeof(UINT_PTR) - 1)) == 0)
+	{
+		FunctionID caller = GetFrameFunction(((UINT_PTR*)frame)[1]);
+		if (caller == 0)
+			break;
+		frames[count++] = caller;
+		UINT_PTR nextFrame = ((UINT_PTR*)frame)[0];
+		if (nextFrame <= frame)
+			break;
+		frame = nextFrame;
+	}
+#else
+	UNREFERENCED_PARAMETER(framePointer);
+	// As in GetCallerFunction, the callee is the first return address that is managed code.  
+	PVOID returnAddresses[CallStackMaxDepth + 16];
+	USHORT frameCount = RtlCaptureStackBackTrace(1, _countof(returnAddresses), returnAddresses, NULL);
+	USHORT i = 0;
+	while (i < frameCount && GetFrameFunction((UINT_PTR)returnAddresses[i]) != functionID)
+		i++;
+	for (i++; i < frameCount && count < maxFrames; i++)
+	{
+		FunctionID caller = GetFrameFunction((UINT_PTR)returnAddresses[i]);
+		if (caller != 0)
+			frames[count++] = caller;
+	}
+#endif
+	return count;
+}
+
+//************************
+// Returns the FunctionID of the method that called the method whose enter hook we are in (0 if it is not managed).  
+// On X86 the JIT gives methods with hooks an EBP frame, so the naked hook passes us that ('framePointer').  
+// On X64 we unwind (the JIT registers unwind information for managed code).  
+static __declspec(noinline) FunctionID GetCallerFunction(FunctionID functionID, UINT_PTR framePointer)
+{
+	UINT_PTR callerIP = 0;
+#if defined(_M_IX86)
+	UNREFERENCED_PARAMETER(functionID);
+	if (framePointer != 0)
+		callerIP = ((UINT_PTR*)framePointer)[1];
+#else
+	UNREFERENCED_PARAMETER(framePointer);
+	// The return addresses are in EnterMethod, EnterMethodSampleNaked, then the callee (the naked hooks have no frame 
+	// of their own), then the caller.  Find the callee by looking for the first return address that is managed code.  
+	PVOID returnAddresses[8];
+	USHORT frameCount = RtlCaptureStackBackTrace(1, _countof(returnAddresses), returnAddresses, NULL);
+	for (USHORT i = 0; i + 1 < frameCount; i++)
+	{
+		FunctionID frameFunction = 0;
+		if (s_tracer->GetFunctionFromIP((UINT_PTR)returnAddresses[i], &frameFunction) && frameFunction == functionID)
+		{
+			callerIP = (UINT_PTR)returnAddresses[i + 1];
+			break;
+		}
+	}
+#endif
+	FunctionID caller = 0;
+	if (callerIP != 0)
+		s_tracer->GetFunctionFromIP(callerIP, &caller);
+	return caller;
+}
+
+EXTERN_C void __stdcall EnterMethod(FunctionID functionID, UINT_PTR framePointer)
+{
+	bool isAnchor = (functionID & CallScopeAnchorTag) != 0;
+	functionID &= ~(FunctionID)CallScopeAnchorTag;
+	if (CallScopeEnabled)
+	{
+		// Forget the anchors we were in before CallScoped was turned on (we never saw them leave).  
+		if (CallScopeThreadGeneration != CallScopeGeneration)
+		{
+			CallScopeDepth = 0;
+			CallScopeThreadGeneration = CallScopeGeneration;
+		}
+		if (isAnchor && CallScopeDepth++ == 0)
+			EventWriteCallScopeStartEvent(functionID);
+		if (CallScopeDepth == 0)
+		{
+			CallSampleCount = CallScopeIdleCount;
+			return;
+		}
+	}
+
+	// A thread's count starts at 0, so its first call makes it negative.   Start each thread at a random 
+	// point in the sampling interval so that the threads' samples are not correlated with each other.  
+	if (CallSampleCount < 0 && CallSamplingRate > 1)
+	{
+		ULONG random = (GetCurrentThreadId() * 0x9E3779B1) ^ GetTickCount();
+		random ^= random >> 15;
+		random *= 0x2C1B3C6D;
+		random ^= random >> 12;
+		CallSampleCount = 1 + (int)(random % (ULONG)CallSamplingRate);
+		return;
+	}
+	CallSampleCount = CallSamplingRate;
+
+	if (CallCountingEnabled)
+	{
+		if (CallCounts == NULL)
+			CallCounts = s_tracer->NewCallCountTable();
+		else if (CallCounts->Generation != CallCountGeneration)
+			CallCounts->Clear(CallCountGeneration);
+		CallCounts->Increment(functionID);
+	}
+	if (CallEventRate != 0 && --CallEventCount <= 0)
+	{
+		if (CallEnterEventsEnabled)
+		{
+			DefineFunction(functionID);
+			EventWriteCallEnterEvent(functionID, CallSamplingRate * CallEventRate);
+		}
+		if (CallGraphEnabled)
+		{
+			if (CallEdges == NULL)
+				CallEdges = s_tracer->NewCallEdgeTable();
+			CallEdges->Increment(functionID, GetCallerFunction(functionID, framePointer));
+		}
+		if (CallStacksEnabled)
+		{
+			ULONGLONG frames[CallStackMaxDepth];
+			ULONG frameCount = CaptureCallStack(functionID, framePointer, frames, CallStackMaxDepth);
+			EventWriteCallStackSampleEvent(functionID, CallSamplingRate * CallEventRate, s_tracer->InternStack(frames, frameCount));
+		}
+		CallEventCount = CallEventRate;
+	}
+	if (CallTreeEnabled)
+	{
+		if (CallTreeStack == NULL)
+			CallTreeStack = s_tracer->NewCallTree();
+		CallTreeStack->Enter(functionID, __rdtsc(), CallTreeGeneration);
+	}
+	if (MethodLatencyEnabled)
+	{
+		// Forget the methods we were in before MethodLatency was turned on (we never saw them leave).  
+		if (LatencyStackGeneration != MethodLatencyGeneration)
+		{
+			LatencyDepth = 0;
+			LatencyStackGeneration = MethodLatencyGeneration;
+		}
+		if (LatencyDepth < MethodLatencyMaxDepth)
+		{
+			LatencyStack[LatencyDepth].ID = functionID;
+			LatencyStack[LatencyDepth].EnterTicks = __rdtsc();
+		}
+		LatencyDepth++;
+	}
+}
+
+// Called by the leave hooks when the method returns, and by the tail call hook (since a tail call leaves the caller).  
+EXTERN_C void __stdcall LeaveMethod(FunctionID functionID)
+{
+	bool isAnchor = (functionID & CallScopeAnchorTag) != 0;
+	functionID &= ~(FunctionID)CallScopeAnchorTag;
+	if (CallScopeEnabled && isAnchor && CallScopeDepth > 0 && CallScopeThreadGeneration == CallScopeGeneration)
+	{
+		if (--CallScopeDepth == 0)
+		{
+			EventWriteCallScopeStopEvent(functionID);
+			CallSampleCount = CallScopeIdleCount;
+		}
+	}
+
+	if (CallTreeEnabled && CallTreeStack != NULL)
+		CallTreeStack->Leave(functionID, __rdtsc(), CallTreeGeneration);
+	if (MethodLatencyEnabled && LatencyDepth > 0 && LatencyStackGeneration == MethodLatencyGeneration)
+	{
+		ULONGLONG now = __rdtsc();
+		if (LatencyDepth > MethodLatencyMaxDepth)
+		{
+			LatencyDepth--;			// A frame we did not time
+			return;
+		}
+
+		// Normally the method is on the top of the stack, but if we missed a leave, pop the frames above it too.  
+		int depth = LatencyDepth;
+		while (depth > 0 && LatencyStack[depth - 1].ID != functionID)
+			--depth;
+		if (depth > 0)
+		{
+			MethodLatencyHistogram* histogram = FindMethodLatency(functionID);
+			if (histogram != NULL)
+				histogram->Add(now - LatencyStack[depth - 1].EnterTicks);
+			LatencyDepth = depth - 1;
+		}
+	}
+}
+
+// The FunctionIDMapper2 we install if PerfView_MethodLatency or PerfView_CallScopeAnchors is set.  If PerfView_MethodLatency 
+// is set, only the methods it selects (and the anchors) get the enter and leave hooks, so everything else runs uninstrumented 
+// (and Call, CallCount and CallTree only see the selected methods).  The anchors' client IDs are tagged with CallScopeAnchorTag.  
+static UINT_PTR __stdcall FunctionMapper(FunctionID functionId, void* clientData, BOOL* pbHookFunction)
+{
+	CorProfilerTracer* tracer = (CorProfilerTracer*)clientData;
+	bool isAnchor = false;
+	*pbHookFunction = tracer->SelectHookedFunction(functionId, &isAnchor);
+	return isAnchor ? (functionId | CallScopeAnchorTag) : functionId;
+}
+
+// Computes CallSampleCountTlsOffset, which is the same for every thread.  
+static void InitCallSampleCountTlsOffset()
+{
+#if defined(_M_IX86)
+	BYTE* tlsBlock = ((BYTE**)__readfsdword(0x2C))[_tls_index];
+#else
+	BYTE* tlsBlock = ((BYTE**)__readgsqword(0x58))[_tls_index];
+#endif
+	CallSampleCountTlsOffset = (ULONG_PTR)((BYTE*)&CallSampleCount - tlsBlock);
+}
+
+#if defined(_M_IX86)
+// see http://msdn.microsoft.com/en-us/library/4ks26t93.aspx  for inline assembly.   Not supported on X64.   
+
+void __declspec(naked) __stdcall EnterMethodNaked(FunctionIDOrClientID)
+{
+	__asm
+	{
+		cmp CallSamplingEnabled, 0
+		jne CountCall
+		ret 4
+
+		CountCall:
+		test byte ptr[esp + 4], 1		// CallScoped anchors always take a sample
+		jnz TakeSample
+		push eax
+		push ecx
+		mov eax, _tls_index
+		mov ecx, fs:[2Ch]				// The thread's TLS array 
+		mov ecx, [ecx + eax * 4]
+		add ecx, CallSampleCountTlsOffset
+		dec dword ptr[ecx]
+		pop ecx
+		pop eax
+		jle TakeSample
+		ret 4
+
+		TakeSample:
+		push eax
+			push ecx
+			push edx
+			push ebp			// Push the callee's frame pointer
+			push[esp + 20]		// Push the function ID
+			call EnterMethod
+			pop edx
+			pop ecx
+			pop eax
+			ret 4
+	}
+} // EnterNaked
+
+void __declspec(naked) __stdcall LeaveMethodNaked(FunctionIDOrClientID)
+{
+	__asm
+	{
+		cmp CallLeaveEnabled, 0
+		jne TakeSample
+		test byte ptr[esp + 4], 1		// CallScoped anchors always call LeaveMethod
+		jnz TakeSample
+		ret 4
+
+		TakeSample:
+		push eax
+			push ecx
+			push edx
+			push[esp + 16]		// Push the function ID
+			call LeaveMethod
+			pop edx
+			pop ecx
+			pop eax
+			ret 4
+	}
+} // LeaveNaked
+
+void __declspec(naked) __stdcall TailcallMethodNaked(FunctionIDOrClientID)
+{
+	__asm
+	{
+		cmp CallLeaveEnabled, 0
+		jne LeaveMethodNaked
+		test byte ptr[esp + 4], 1
+		jnz LeaveMethodNaked
+		jmp EnterMethodNaked
+	}
+}
+
+#else
+EXTERN_C void __stdcall EnterMethodNaked(FunctionIDOrClientID functionID);
+EXTERN_C void __stdcall LeaveMethodNaked(FunctionIDOrClientID functionID);
+EXTERN_C void __stdcall TailcallMethodNaked(FunctionIDOrClientID functionID);
+#endif 
+
+//==========================================================================
+// The constructor does almost nothing because we need the ability to call
+// back to the runtime.   Thus the 'real' initialization happens in
+// this routine.   In particular we register ProfilerControlCallback with
+// ETW.
+// We make Initialize call this routine with pvClientData = NULL, cbClientData = -1;
+HRESULT STDMETHODCALLTYPE CorProfilerTracer::InitializeForAttach(
+	/* [in] */ IUnknown *pICorProfilerInfoUnk,
+	/* [in] */ void *pvClientData,
+	/* [in] */ UINT cbClientData)
+{
+	UNREFERENCED_PARAMETER(pvClientData);
+
+	HRESULT             hr = S_OK;
+	LOG_TRACE(L"ClrProfiler Initializing\n");
+	CALL_N_LOGONBADHR(pICorProfilerInfoUnk->QueryInterface(__uuidof(ICorProfilerInfo3), (void **)&m_info));
+
+	// In my Initialize() method I call InitializeForAttach with cbClientData == -1.   This is convenient 
+	// since most of the logic is the same.  
+	m_profilerLoadedAtStartup = ((int)cbClientData < 0);
+
+	// Some of the GC keywords have settings that can be overridden in the registry.  
+	m_arrayWasteMinSize = GetPerfViewSetting(L"PerfView_ArrayWasteMinSize", ArrayWasteMinSize);
+	m_heapSampleRate = max(GetPerfViewSetting(L"PerfView_HeapSampleRate", HeapSampleRate), 1UL);
+	m_callSamplingRate = max(GetPerfViewSetting(L"PerfView_CallSamplingRate", CallSamplingRateDefault), 1UL);
+	m_flushIntervalMSec = GetPerfViewSetting(L"PerfView_SummaryFlushMSec", 0);
+
+	m_cpuSampleIntervalMSec = max(GetPerfViewSetting(L"PerfView_CpuSampleMSec", CpuSampleIntervalMSec), 1UL);
+	m_safePointStacks = GetPerfViewSetting(L"PerfView_SafePointStacks", 0) != 0;
+	m_exceptionStackRate = max(GetPerfViewSetting(L"PerfView_ExceptionStackRate", ExceptionStackSampleRate), 1UL);
+	m_startupWindowMSec = GetPerfViewSetting(L"PerfView_StartupSeconds", StartupTimelineSeconds) * 1000;
+
+	// CallTree and MethodLatency time things with the time stamp counter, we find its rate by comparing it 
+	// with QueryPerformanceCounter over the life of the process.  
+	QueryPerformanceCounter(&m_tscStartQpc);
+	m_tscStartTsc = __rdtsc();
+	m_startupStartTick = GetTickCount();
+
+	// Initialize the ETW Provider.  
+	LOG_TRACE(L"Registering the ETW provider\n");
+	CALL_N_LOGONBADHR(EventRegisterETWClrProfiler(ProfilerControlCallback, this));
+
+	// CpuSamples needs to know every managed thread (including the ones created before it was turned on), CallCount 
+	// and CallTree add up the tables of the threads that die when they do (see ThreadDestroyed), and the 
+	// thread callbacks are cheap, so we always track them.  
+	{
+		DWORD threadFlags = 0;
+		CALL_N_LOGONBADHR(m_info->GetEventMask(&threadFlags));
+		CALL_N_LOGONBADHR(m_info->SetEventMask(threadFlags | COR_PRF_MONITOR_THREADS));
+	}
+
+	// If we are not attaching, turn on all the events we can only turned on at init time.  
+	if (m_profilerLoadedAtStartup)
+	{
+		// Even if we did not ask for them, turn on the profiler flags that can ONLY be done at startup. 
+		DWORD oldFlags = 0;
+		CALL_N_LOGONBADHR(m_info->GetEventMask(&oldFlags));
+		CALL_N_LOGONBADHR(m_info->SetEventMask(oldFlags | COR_PRF_MONITOR_MODULE_LOADS | COR_PRF_ENABLE_OBJECT_ALLOCATED));
+
+		// See if we asked to disable inlining.  
+		DWORD keywords = GetPerfViewSetting(L"PerfView_Keywords", 0);
+		if ((keywords & DisableInliningKeyword) != 0)
+		{
+			CALL_N_LOGONBADHR(m_info->GetEventMask(&oldFlags));
+			CALL_N_LOGONBADHR(m_info->SetEventMask(oldFlags | COR_PRF_DISABLE_INLINING));
+		}
+
+		// The transition callbacks can only be turned on now, so Transitions must be asked for up front.  They stay 
+		// on (and just test m_currentKeywords) while the keyword is off.  
+		if ((keywords & TransitionsKeyword) != 0)
+		{
+			CALL_N_LOGONBADHR(m_info->GetEventMask(&oldFlags));
+			CALL_N_LOGONBADHR(m_info->SetEventMask(oldFlags | COR_PRF_MONITOR_CODE_TRANSITIONS));
+		}
+
+		// Turn on the Call entry hooks.   They can only be installed now, so we always do it, but they 
+		// stay dormant (they just test CallSamplingEnabled) until the Call, CallSampled or CallCount keyword is turned on. 
+		// The leave hooks make every method return slower, so we only install them if CallTree was asked for, 
+		// PerfView_MethodLatency selected methods (and then only those methods get hooks at all), or 
+		// PerfView_CallScopeAnchors selected anchors for CallScoped.  
+		assert(s_tracer == NULL);
+		s_tracer = this;
+		InitCallSampleCountTlsOffset();
+		m_callTreeHooks = (keywords & CallTreeKeyword) != 0;
+		m_methodLatencyHooks = GetPerfViewStringSetting(L"PerfView_MethodLatency", m_methodLatencyPatterns, _countof(m_methodLatencyPatterns));
+		m_callScopeHooks = GetPerfViewStringSetting(L"PerfView_CallScopeAnchors", m_callScopeAnchors, _countof(m_callScopeAnchors));
+		if (m_methodLatencyHooks || m_callScopeHooks)
+			CALL_N_LOGONBADHR(m_info->SetFunctionIDMapper2(FunctionMapper, this));
+		bool leaveHooks = m_callTreeHooks || m_methodLatencyHooks || m_callScopeHooks;
+		CALL_N_LOGONBADHR(m_info->SetEnterLeaveFunctionHooks3(EnterMethodNaked, leaveHooks ? LeaveMethodNaked : 0, TailcallMethodNaked));
+		CALL_N_LOGONBADHR(m_info->GetEventMask(&oldFlags));
+		CALL_N_LOGONBADHR(m_info->SetEventMask(oldFlags | COR_PRF_MONITOR_ENTERLEAVE));
+	}
+
+	// If asked, periodically log the summaries we accumulate in process (not just on capture state).  
+	if (m_flushIntervalMSec != 0)
+	{
+		m_flushStopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+		if (m_flushStopEvent != NULL)
+			m_flushThread = CreateThread(NULL, 0, FlushThreadProc, this, 0, NULL);
+	}
+exit:
+	LOG_TRACE(L"Initialize() returns %x\n", hr);
+	return hr;
+}
+
+//==============================================================================
+// This routine does the work of responding to a ETW request from the controller 
+void CorProfilerTracer::DoETWCommand(ULONG IsEnabled, UCHAR Level, ULONGLONG MatchAnyKeywords, struct _EVENT_FILTER_DESCRIPTOR* filterData)
+{
+	UNREFERENCED_PARAMETER(Level);
+
+	LOG_TRACE(L"DoETWCommand(IsEnabled=%d, Level=%d Keywords=0x%x,%x)\n", IsEnabled, Level, (int)(MatchAnyKeywords >> 32), (int)MatchAnyKeywords);
+
+	const DWORD FLAGS_CAN_SET = (COR_PRF_MONITOR_OBJECT_ALLOCATED | COR_PRF_MONITOR_MODULE_LOADS | COR_PRF_MONITOR_GC | COR_PRF_MONITOR_EXCEPTIONS | COR_PRF_ENABLE_STACK_SNAPSHOT | 
+		COR_PRF_MONITOR_JIT_COMPILATION | COR_PRF_MONITOR_CLASS_LOADS | COR_PRF_MONITOR_ASSEMBLY_LOADS | COR_PRF_MONITOR_SUSPENDS);
+	DWORD oldFlags = 0;
+	m_info->GetEventMask(&oldFlags);
+	DWORD newFlags = oldFlags;
+
+	if (IsEnabled == EVENT_CONTROL_CODE_ENABLE_PROVIDER)
+	{
+		DWORD callSamplingRate = 0;
+		if (GetFilterDataValue(filterData, "CallSamplingRate", &callSamplingRate) && callSamplingRate > 0)
+			m_callSamplingRate = callSamplingRate;
+
+		// Forget the JIT compilations that were in progress when JitLatency was last turned off.  
+		if ((MatchAnyKeywords & JitLatencyKeyword) != 0 && (m_currentKeywords & JitLatencyKeyword) == 0)
+			InterlockedIncrement(&JitLatencyGeneration);
+		// Likewise the P/Invokes that were in progress when Transitions was last turned off.  
+		if ((MatchAnyKeywords & TransitionsKeyword) != 0 && (m_currentKeywords & TransitionsKeyword) == 0)
+			InterlockedIncrement(&TransitionGeneration);
+		m_currentKeywords = MatchAnyKeywords;
+
+		// Depending on what we asked for in the Keywords, turn on the cooresponding Profiler callbacks.  
+		newFlags = (oldFlags & ~FLAGS_CAN_SET);
+		newFlags |= COR_PRF_MONITOR_MODULE_LOADS;
+
+		if ((MatchAnyKeywords & (GCKeyword | GCAllocKeyword | GCAllocSampledKeyword | GCHeapKeyword | GCFragmentationKeyword | GCHandleSummaryKeyword | FinalizerSummaryKeyword | GCPromotionKeyword | DuplicateStringsKeyword | ArrayWasteKeyword | GCHeapSampledKeyword | GCPausesKeyword)))
+			newFlags |= COR_PRF_MONITOR_GC;
+		if ((MatchAnyKeywords & (GCPausesKeyword | SafePointsKeyword)) != 0)
+			newFlags |= COR_PRF_MONITOR_SUSPENDS;
+		if ((MatchAnyKeywords & SafePointsKeyword) != 0 && m_safePointStacks)
+			newFlags |= COR_PRF_ENABLE_STACK_SNAPSHOT;
+		if ((MatchAnyKeywords & ExceptionsKeyword) != 0)
+			newFlags |= COR_PRF_MONITOR_EXCEPTIONS | COR_PRF_ENABLE_STACK_SNAPSHOT;
+		if ((MatchAnyKeywords & (GCAllocKeyword | GCAllocSampledKeyword)) != 0 && m_profilerLoadedAtStartup)
+		{
+			newFlags |= COR_PRF_MONITOR_OBJECT_ALLOCATED;
+			if ((MatchAnyKeywords & GCAllocSampledKeyword) != 0)
+				m_smartSampling = true;
+		}
+
+		// The call hooks were installed at startup (if we were not attached), we just wake them up.  
+		// If we are counting calls (or building call trees or timing methods), the hooks must call EnterMethod on every call and it does the sampling.  
+		// CallGraph and CallStacks use the same samples as CallSampled.  CallScoped limits all of this to the threads that are in an 
+		// anchor method, and logs every call there (unless CallSampled asks for sampling).  
+		bool callScoped = (MatchAnyKeywords & CallScopedKeyword) != 0 && m_callScopeHooks;
+		bool callEvents = (MatchAnyKeywords & (CallKeyword | CallSampledKeyword)) != 0 || callScoped;
+		bool callGraph = (MatchAnyKeywords & CallGraphKeyword) != 0;
+		bool callStacks = (MatchAnyKeywords & CallStacksKeyword) != 0;
+		bool callSamples = callEvents || callGraph || callStacks;
+		bool callCounts = (MatchAnyKeywords & CallCountKeyword) != 0;
+		bool callTree = (MatchAnyKeywords & CallTreeKeyword) != 0 && m_callTreeHooks;
+		bool methodLatency = (MatchAnyKeywords & MethodLatencyKeyword) != 0 && m_methodLatencyHooks;
+		if ((callSamples || callCounts || callTree || methodLatency) && m_profilerLoadedAtStartup)
+		{
+			bool everyCall = callCounts || callTree || methodLatency;
+			bool everyEvent = (MatchAnyKeywords & CallKeyword) != 0 || (callScoped && (MatchAnyKeywords & CallSampledKeyword) == 0);
+			int eventRate = everyEvent ? 1 : (int)m_callSamplingRate;
+			// CallCount counts the calls since it was turned on.  The threads clear their own tables when they see the new generation.  
+			if (callCounts && !CallCountingEnabled)
+			{
+				EnterCriticalSection(&m_callCountLock);
+				m_deadThreadCallCounts.clear();
+				InterlockedIncrement(&CallCountGeneration);
+				LeaveCriticalSection(&m_callCountLock);
+			}
+			CallCountingEnabled = callCounts;
+			CallSamplingRate = everyCall ? 1 : eventRate;
+			CallEventRate = !callSamples ? 0 : (everyCall ? eventRate : 1);
+			CallEnterEventsEnabled = callEvents;
+			CallGraphEnabled = callGraph;
+			CallStacksEnabled = callStacks;
+			if (callTree && !CallTreeEnabled)
+				InterlockedIncrement(&CallTreeGeneration);
+			if (methodLatency && !MethodLatencyEnabled)
+				InterlockedIncrement(&MethodLatencyGeneration);
+			if (callScoped && !CallScopeEnabled)
+				InterlockedIncrement(&CallScopeGeneration);
+			CallScopeEnabled = callScoped;
+			CallTreeEnabled = callTree;
+			MethodLatencyEnabled = methodLatency;
+			CallLeaveEnabled = callTree || methodLatency;
+			CallSamplingEnabled = 1;
+		}
+		else
+		{
+			CallSamplingEnabled = 0;
+			CallCountingEnabled = 0;
+			CallGraphEnabled = 0;
+			CallStacksEnabled = 0;
+			CallScopeEnabled = 0;
+			CallTreeEnabled = 0;
+			MethodLatencyEnabled = 0;
+			CallLeaveEnabled = 0;
+		}
+		// We need the exception unwind callbacks to pop the methods an exception leaves.  
+		if (callTree || methodLatency || callScoped)
+			newFlags |= COR_PRF_MONITOR_EXCEPTIONS;
+
+		if ((MatchAnyKeywords & (JitLatencyKeyword | PerfMapKeyword | JitInliningKeyword | StartupTimelineKeyword)) != 0)
+			newFlags |= COR_PRF_MONITOR_JIT_COMPILATION;
+		if ((MatchAnyKeywords & StartupTimelineKeyword) != 0)
+			newFlags |= COR_PRF_MONITOR_CLASS_LOADS | COR_PRF_MONITOR_ASSEMBLY_LOADS;
+		if ((MatchAnyKeywords & PerfMapKeyword) == 0)
+			m_perfMap->Stop();
+
+		// CpuSamples does not need the hooks, so it works when we attach too (ProfilerAttachComplete finds the existing threads).  
+		if ((MatchAnyKeywords & CpuSamplesKeyword) != 0)
+		{
+			newFlags |= COR_PRF_ENABLE_STACK_SNAPSHOT;
+			StartCpuSampling();
+		}
+		else
+			StopCpuSampling();
+
+		// We send the manifest on Provider startup.   
+		if (MatchAnyKeywords != 0 && !m_sentManifest)
+		{
+#if 0 
+			LOG_TRACE(L"Sending Manifest\n");
+			EventWriteSendManifestEvent(1, 1, 0, 0x5B, 1, 0, "<instrumentationManifest/>"); THis is not right, it is not null terminated.
+				m_sentManifest = true;
+#endif 
+		}
+	}
+	else if (IsEnabled == EVENT_CONTROL_CODE_CAPTURE_STATE)
+	{
+		EventWriteCaptureStateStart();
+
+		// You send the manifest if you don't ask for any other type of rundown or you asked for every other type of rundown.
+		if (MatchAnyKeywords == 0 || MatchAnyKeywords == 0xFFFFFFFFFFFFFFFF)
+		{
+#if 0 
+			LOG_TRACE(L"Sending Manifest\n");
+			EventWriteSendManifestEvent(1, 1, 0, 0x5B, 1, 0, "<instrumentationManifest/>"); THis is not right, it is not null terminated.
+#endif 
+		}
+		if ((MatchAnyKeywords & (GCHeapKeyword | GCHeapSampledKeyword | DuplicateStringsKeyword | ArrayWasteKeyword)) != 0)
+		{
+			LOG_TRACE(L"Forcing GC\n");
+			ForceGC();
+			LOG_TRACE(L"Done Forcing GC\n");
+		}
+		if ((MatchAnyKeywords & (GCKeyword | CallKeyword | CallSampledKeyword | CallCountKeyword | CallTreeKeyword | MethodLatencyKeyword | CallGraphKeyword | CallScopedKeyword | CallStacksKeyword | CpuSamplesKeyword | JitLatencyKeyword | JitInliningKeyword | StartupTimelineKeyword | SafePointsKeyword | ExceptionsKeyword | TransitionsKeyword)) != 0)
+		{
+			LOG_TRACE(L"Dumping Class Information\n");
+			DumpClassInfo();
+			LOG_TRACE(L"Dumping Class Information\n");
+		}
+		if ((MatchAnyKeywords & GCHandleSummaryKeyword) != 0)
+			LogHandleSummary();
+		if ((MatchAnyKeywords & GCPausesKeyword) != 0)
+			LogGCPauseHistograms();
+		if ((MatchAnyKeywords & CallCountKeyword) != 0)
+			LogCallCounts();
+		if ((MatchAnyKeywords & CallGraphKeyword) != 0)
+			LogCallEdges();
+		if ((MatchAnyKeywords & CallTreeKeyword) != 0)
+			LogCallTree();
+		if ((MatchAnyKeywords & MethodLatencyKeyword) != 0)
+			LogMethodLatency();
+		if ((MatchAnyKeywords & JitLatencyKeyword) != 0)
+			LogJitTimes();
+		if ((MatchAnyKeywords & JitInliningKeyword) != 0)
+			LogJitInlines();
+		if ((MatchAnyKeywords & StartupTimelineKeyword) != 0)
+			LogStartupTimeline();
+		if ((MatchAnyKeywords & ExceptionsKeyword) != 0)
+			LogExceptions();
+		if ((MatchAnyKeywords & TransitionsKeyword) != 0)
+			LogTransitions();
+
+		// Indicate that we are done with capture state processing
+		EventWriteCaptureStateStop();
+
+		// Detach is special, we do it after logging we are done with CaptureState activity (Because we could start tearing down)
+		if ((MatchAnyKeywords & DetachKeyword) != 0 && !m_profilerLoadedAtStartup && !m_detaching)
+		{
+			m_detaching = true;
+			LOG_TRACE(L"Detaching\n");
+			HRESULT hr = m_info->RequestProfilerDetach(1000);
+			LOG_TRACE(L"Done Detaching Detaching ret = 0x%x\n", hr);
+			if (hr != S_OK)
+				EventWriteProfilerError(hr, L"Request Profiler Detach Failed");
+		}
+	}
+	else    // (IsEnabled == EVENT_CONTROL_CODE_DISABLE_PROVIDER)   
+	{
+		StopCpuSampling();
+		m_perfMap->Stop();
+		ClearTables();
+		m_sentManifest = 0;
+		// We reset all flags on disable. 
+		newFlags = (oldFlags & ~FLAGS_CAN_SET);
+		m_currentKeywords = 0;
+		CallSamplingEnabled = 0;
+		CallCountingEnabled = 0;
+		CallGraphEnabled = 0;
+		CallStacksEnabled = 0;
+		CallScopeEnabled = 0;
+		CallTreeEnabled = 0;
+		MethodLatencyEnabled = 0;
+		CallLeaveEnabled = 0;
+	}
+
+	// If we updated the profiler flags, actually send the update to the profiler.  
+	if (newFlags != oldFlags && !m_detaching)
+	{
+		HRESULT hr = m_info->SetEventMask(newFlags);
+		LOG_TRACE(L"DoETWCommand SetEventMask 0x%x returning 0x%x\n", newFlags, hr);
+		if (hr != S_OK)
+			EventWriteProfilerError(hr, L"Profiler SetEventMask Failed");
+	}
+
+	// We start the perf map after the JIT callbacks are on, so no method is compiled after we list the 
+	// compiled methods but before JITCompilationFinished is called.  
+	if (IsEnabled == EVENT_CONTROL_CODE_ENABLE_PROVIDER && (MatchAnyKeywords & PerfMapKeyword) != 0)
+		StartPerfMap();
+}
+
+//==============================================================================
+// The constuctor does almost nothing, the real action happens
+// in initialize (where we have a ProfilerInfo to call back to
+// the runtime with)
+CorProfilerTracer::CorProfilerTracer()
+{
+#if DEBUG
+	// We put the log in the temp directory in a file called ETWClrProfiler.log
+	wchar_t logFilePath[MAX_PATH];
+	GetEnvironmentVariableW(L"Temp", logFilePath, MAX_PATH);
+	wcscat_s(logFilePath, MAX_PATH, L"\\ETWClrProfiler.log");
+
+	// the convention is that if the file exists, then we write to it, otherwise we do nothing.  
+	DWORD attr = GetFileAttributesW(logFilePath);
+	if (attr != INVALID_FILE_ATTRIBUTES)
+		OPEN_LOG(TRACE_LOGGER, logFilePath);
+#endif 
+
+	LOG_TRACE(L"Creating new CorProfilerInstance\n");
+	m_refCount = 0;
+	m_info = NULL;
+	m_gcCount = 0;
+	m_curAllocSize = 0;
+	m_smartSampling = false;
+	m_forcingGC = false;
 	m_currentKeywords = 0;
 	m_profilerLoadedAtStartup = false;
 	m_detaching = false;
 	m_sentManifest = false;
+	m_analyzeFragmentation = false;
 	memset(&m_lock, 0, sizeof(CRITICAL_SECTION));
 	InitializeCriticalSection(&m_lock);
+	memset(&m_handleLock, 0, sizeof(CRITICAL_SECTION));
+	InitializeCriticalSection(&m_handleLock);
+	m_liveHandles = new LiveHandleTable();
+	m_lastHandleSummaryTick = 0;
+	m_pauseHistograms.assign(SuspendReasonCount * PausePhaseCount, NULL);
+	m_suspendReason = COR_PRF_SUSPEND_OTHER;
+	m_suspendStartTicks = 0;
+	m_suspendFinishTicks = 0;
+	m_gcStartTicks = 0;
+	m_gcFinishTicks = 0;
+	m_resumeStartTicks = 0;
+	m_pauseGCCount = 0;
+	m_lastPauseHistogramTick = 0;
+	m_safePointStacks = false;
+	m_exceptionStackRate = ExceptionStackSampleRate;
+	m_promotionGeneration = -1;
+	m_promotionSampleCountdown = PromotionSampleRate;
+	m_analyzeStrings = false;
+	m_stringClassId = 0;
+	m_stringLengthOffset = 0;
+	m_stringBufferOffset = 0;
+	m_analyzeArrays = false;
+	m_arrayWasteMinSize = ArrayWasteMinSize;
+	m_arrayScanBudget = 0;
+	m_heapSampleRate = HeapSampleRate;
+	m_callSamplingRate = CallSamplingRateDefault;
+	memset(&m_callCountLock, 0, sizeof(CRITICAL_SECTION));
+	InitializeCriticalSection(&m_callCountLock);
+	m_flushIntervalMSec = 0;
+	m_flushThread = NULL;
+	m_flushStopEvent = NULL;
+	m_deadThreadCallTree = new CallTree();
+	m_callTreeHooks = false;
+	m_callTreeFlushCount = 0;
+	m_methodLatencyHooks = false;
+	m_methodLatencyPatterns[0] = 0;
+	m_callScopeHooks = false;
+	m_callScopeAnchors[0] = 0;
+	m_callScopeAnchorCount = 0;
+	m_tscStartQpc.QuadPart = 0;
+	m_tscStartTsc = 0;
+	m_stacks = new StackTable();
+	memset(&m_threadLock, 0, sizeof(CRITICAL_SECTION));
+	InitializeCriticalSection(&m_threadLock);
+	memset(&m_safePointLock, 0, sizeof(CRITICAL_SECTION));
+	InitializeCriticalSection(&m_safePointLock);
+	m_cpuSampleIntervalMSec = CpuSampleIntervalMSec;
+	m_cpuSampleThread = NULL;
+	m_cpuSampleStopEvent = NULL;
+	m_jitHistogram = new MethodLatencyHistogram(0, L"JIT");
+	m_perfMap = new PerfMapWriter();
+	m_startupStartTick = 0;
+	m_startupWindowMSec = StartupTimelineSeconds * 1000;
+	m_startupLogged = 0;
+}
+
+//==============================================================================
+CorProfilerTracer :: ~CorProfilerTracer()
+{
+	if (m_info != NULL)
+		m_info->Release();
+
+	delete m_liveHandles;
+	DeleteCriticalSection(&m_handleLock);
+	for (auto it = m_callCountTables.begin(); it != m_callCountTables.end(); ++it)
+		delete it->second;
+	for (auto it = m_callEdgeTables.begin(); it != m_callEdgeTables.end(); ++it)
+		delete *it;
+	for (auto it = m_callTrees.begin(); it != m_callTrees.end(); ++it)
+		delete it->second;
+	delete m_deadThreadCallTree;
+	for (auto it = m_methodLatencies.begin(); it != m_methodLatencies.end(); ++it)
+		delete *it;
+	for (auto it = m_frameCaches.begin(); it != m_frameCaches.end(); ++it)
+		delete[] *it;
+	for (auto it = m_jitInlineTables.begin(); it != m_jitInlineTables.end(); ++it)
+		delete *it;
+	for (auto it = m_transitionTables.begin(); it != m_transitionTables.end(); ++it)
+		delete *it;
+	for (auto it = m_startupLogs.begin(); it != m_startupLogs.end(); ++it)
+		delete *it;
+	for (auto it = m_pauseHistograms.begin(); it != m_pauseHistograms.end(); ++it)
+		delete *it;
+	delete m_stacks;
+	delete m_jitHistogram;
+	delete m_perfMap;
+	for (auto it = m_threads.begin(); it != m_threads.end(); ++it)
+	{
+		if (it->second.Handle != NULL)
+			CloseHandle(it->second.Handle);
+	}
+	DeleteCriticalSection(&m_threadLock);
+	DeleteCriticalSection(&m_safePointLock);
+	DeleteCriticalSection(&m_callCountLock);
+	DeleteCriticalSection(&m_lock);
+	LOG_TRACE(L"Destroying CorProfilerInstance\n");
+	CLOSE_LOG(TRACE_LOGGER);
+}
+
+//==============================================================================
+HRESULT CorProfilerTracer::QueryInterface(
+	REFIID  riid,
+	void ** ppInterface)
+{
+	if (riid == IID_IUnknown)
+		*ppInterface = static_cast<ICorProfilerCallback*>(this);
+	else if (riid == IID_ICorProfilerCallback)
+		*ppInterface = static_cast<ICorProfilerCallback*>(this);
+	else if (riid == IID_ICorProfilerCallback2)
+		*ppInterface = static_cast<ICorProfilerCallback2*>(this);
+	else if (riid == IID_ICorProfilerCallback3)
+		*ppInterface = static_cast<ICorProfilerCallback3*>(this);
+	// TODO FIX NOW add support or ICorProfilerCallback4 (for large objects)
+	else
+	{
+		*ppInterface = NULL;
+		return E_NOTIMPL;
+	}
+	reinterpret_cast<IUnknown *>(*ppInterface)->AddRef();
+	return S_OK;
+}
+
+//==============================================================================
+HRESULT CorProfilerTracer::Shutdown()
+{
+	LOG_TRACE(L"Shutdown \n");
+	StopCpuSampling();
+	m_perfMap->Stop();
+	if (m_flushThread != NULL)
+	{
+		SetEvent(m_flushStopEvent);
+		WaitForSingleObject(m_flushThread, INFINITE);
+		CloseHandle(m_flushThread);
+		m_flushThread = NULL;
+	}
+	if (m_flushStopEvent != NULL)
+	{
+		CloseHandle(m_flushStopEvent);
+		m_flushStopEvent = NULL;
+	}
+	EventWriteProfilerShutdown();
+	EventUnregisterETWClrProfiler();
+	ClearTables();
+
+	if (m_info != NULL)
+		m_info->Release();
+	m_info = NULL;
+
+	return S_OK;
+}
+
+//==============================================================================
+// Sends out the accumulated class (and module) information events.  This is for
+// rundown.  
+void CorProfilerTracer::DumpClassInfo()
+{
+	// The call hooks and JIT callbacks add modules and methods at any time, so we need the lock.  
+	EnterCriticalSection(&m_lock);
+	for (auto moduleIter = m_moduleInfo.begin(); moduleIter != m_moduleInfo.end(); moduleIter++)
+	{
+		ModuleInfo* moduleInfo = moduleIter->second;
+		EventWriteModuleIDDefintionEvent(moduleInfo->ID, moduleInfo->AssemblyID, moduleInfo->Path);
+	}
+	for (auto classIter = m_classInfo.begin(); classIter != m_classInfo.end(); classIter++)
+	{
+		ClassInfo* classInfo = classIter->second;
+		ModuleID moduleId = classInfo->ModuleInfo ? classInfo->ModuleInfo->ID : 0;		// Arrays have no module
+		EventWriteClassIDDefintionEvent(classInfo->ID, classInfo->Token, classInfo->Flags, moduleId, classInfo->Name);
+	}
+	for (auto functionIter = m_functionInfo.begin(); functionIter != m_functionInfo.end(); functionIter++)
+	{
+		FunctionInfo* functionInfo = functionIter->second;
+		if (functionInfo->ID != static_cast<FunctionID>(-1))
+		{
+			ModuleID moduleId = functionInfo->ModuleInfo ? functionInfo->ModuleInfo->ID : 0;
+			EventWriteFunctionIDDefinitionEvent(functionInfo->ID, functionInfo->Token, functionInfo->Class, moduleId, functionInfo->Name);
+		}
+	}
+	LeaveCriticalSection(&m_lock);
+}
+
+//==============================================================================
+// Clears out all remembered information from our tables.  Other threads can still be adding to them 
+// (the callbacks are not turned off yet), so we hold the lock the whole time.  
+void CorProfilerTracer::ClearTables()
+{
+	EnterCriticalSection(&m_lock);
+	for (auto classIter = m_classInfo.begin(); classIter != m_classInfo.end(); classIter++)
+		delete classIter->second;
+	m_classInfo.clear();
+	m_finalizedClasses.clear();		// These point at the ClassInfos we just deleted.  
+	m_promotedClasses.clear();
+	m_stringClassId = 0;
+	m_arrayWasteClasses.clear();
+	m_heapSampleClasses.clear();
+	m_exceptionStacks.clear();		// These are counted by class too.  
+
+	for (auto functionIter = m_functionInfo.begin(); functionIter != m_functionInfo.end(); functionIter++)
+		delete functionIter->second;
+	m_functionInfo.clear();
+	InterlockedIncrement(&FunctionInfoGeneration);
+	m_stacks->Clear();			// The StackDefinitions we logged are forgotten too.  
+	m_jitHistogram->Clear();	// As are the JIT times we kept in the FunctionInfos and ModuleInfos
+	for (auto it = m_pauseHistograms.begin(); it != m_pauseHistograms.end(); ++it)
+	{
+		if (*it != NULL)
+			(*it)->Clear();
+	}
+
+	for (auto moduleIter = m_moduleInfo.begin(); moduleIter != m_moduleInfo.end(); moduleIter++)
+		delete moduleIter->second;
+	m_moduleInfo.clear();
+
+	m_survivorRanges.clear();
+	LeaveCriticalSection(&m_lock);
+
+	EnterCriticalSection(&m_handleLock);
+	m_liveHandles->Clear();
+	LeaveCriticalSection(&m_handleLock);
+}
+
+//==============================================================================
+DWORD WINAPI CorProfilerTracer::ForceGCBody(LPVOID lpParameter)
+{
+	LOG_TRACE(L"ForceGCBody");
+	CorProfilerTracer* profiler = (CorProfilerTracer*)lpParameter;
+	HRESULT hr = profiler->m_info->ForceGC();
+	LOG_TRACE(L"ForceGC Call returns 0x%x\n", hr);
+	if (hr != S_OK)
+		EventWriteProfilerError(hr, L"Profiler ForceGC Failed");
+	profiler->m_forcingGC = false;
+	return hr;
+}
+
+//==============================================================================
+// We do the GC on another thread to avoid 'poluting' the ETW callback thread. 
+void CorProfilerTracer::ForceGC()
+{
+	m_forcingGC = true;
+	HANDLE thread = CreateThread(0, 0, ForceGCBody, this, 0, NULL);
+	LOG_TRACE(L"ForceGC: thread 0x%x\n", thread);
+	UNREFERENCED_PARAMETER(thread);
+	for (int i = 0; i < 2000; i++)
+	{
+		if (!m_forcingGC)
+			break;
+		Sleep(10);
+	}
+}
+
+STDMETHODIMP CorProfilerTracer::ModuleAttachedToAssembly(ModuleID moduleId, AssemblyID assemblyId)
+{
+	auto moduleInfo = GetModuleInfo(moduleId);
+	if (moduleInfo && moduleInfo->AssemblyID != assemblyId)
+	{
+		if (!moduleInfo->Path)
+		{
+			ULONG pathLength;
+			AppDomainID appDomainId;
+			ModuleID manifestModuleId;
+			m_info->GetAssemblyInfo(assemblyId, 0, &pathLength, nullptr, &appDomainId, &manifestModuleId);
+			if (pathLength > 0)
+			{
+				moduleInfo->Path = new wchar_t[pathLength];
+				m_info->GetAssemblyInfo(assemblyId, pathLength, &pathLength, moduleInfo->Path, &appDomainId, &manifestModuleId);
+			}
+
+			if (!moduleInfo->Path)
+			{
+				moduleInfo->Path = new wchar_t[1];
+				moduleInfo->Path[0] = L'\0';
+			}
+		}
+
+		moduleInfo->AssemblyID = assemblyId;
+		EventWriteModuleIDDefintionEvent(moduleId, assemblyId, moduleInfo->Path);
+	}
+
+	return S_OK;
+}
+
+//==============================================================================
+STDMETHODIMP CorProfilerTracer::ObjectAllocated(ObjectID objectId, ClassID classId)
+{
+	EnterCriticalSection(&m_lock);
+	// TODO this is probably inefficient, should only call back on classes that are variable sized
+	ULONG size = 0;
+	m_info->GetObjectSize(objectId, &size);
+	ULONG representativeSize = size;
+
+	// We do this for also  the side effect of logging the class  
+	ClassInfo* classInfo = GetClassInfo(classId);
+	if (classInfo == 0)			// TODO FIX NOW, we should log something.  
+		goto Done;
+
+	if (m_smartSampling)
+	{
+		classInfo->AllocsIgnored++;
+		classInfo->IgnoredSize += size;
+
+		// If we are not yet triggering, and the size is below the force keep size, then filter out the sample 
+		if (classInfo->AllocsIgnored < classInfo->SamplingRate && size < classInfo->ForceKeepSize)
+			goto Done;			// Filter out the sample.  
+
+		// TODO FIX NOW HACK for exchange data collection 
+#ifdef PIN_INVESTIGATION
+#define Near(x,y) (y-0x20 <= x && x <= y + 8)
+
+		if (size < classInfo->ForceKeepSize)
+			goto Done;
+		// if (!(Near(size, 0x1e4) || Near(size, 0x4038) || Near(size, 0x403d) || Near(size, 0x1418) || Near(size, 0x2018) || Near(size, 0x53) || Near(size, 0xed8)))
+		   // goto Done;
+#endif 
+		// At this point we will log an event 
+
+		// Compute the average allocation rate for this type and from that compute a good sampling rate.  
+		classInfo->AllocCountInCurrentBucket += classInfo->AllocsIgnored;
+		int ticks = GetTickCount();
+		int delta = (ticks - classInfo->TickOfCurrentTimeBucket) & 0x7FFFFFFF;	// make wrap around work.  
+
+		int minAllocPerMSec = classInfo->AllocCountInCurrentBucket / 16;		// This is an underestimation of the true rate.  
+		if (delta >= 16 || (minAllocPerMSec > 2 && minAllocPerMSec > classInfo->AllocPerMSec * 1.5F))
+		{
+			float newAllocPerMSec = 0;
+			if (delta >= 16)
+			{
+				// This is the normal case, our allocation rate is under control with the current throttling.   
+				newAllocPerMSec = ((float)classInfo->AllocCountInCurrentBucket) / delta;
+				// Do a exponential decay window that is 5 * max(16, AllocationInterval)  
+				classInfo->AllocPerMSec = 0.8F *  classInfo->AllocPerMSec + 0.2F * newAllocPerMSec;
+				classInfo->TickOfCurrentTimeBucket = ticks;
+				classInfo->AllocCountInCurrentBucket = 0;
+			}
+			else
+			{
+				newAllocPerMSec = (float)minAllocPerMSec;
+				// This means the second clause above is true, which means our sampling rate is too low
+				// so we need to throttle quickly. 
+				classInfo->AllocPerMSec = (float)minAllocPerMSec;
+			}
+
+			// We want to sample at a rate that ensures less 100 allocations per second per type.  
+			// However don't sample less than 1/1000, 
+			classInfo->SamplingRate = min((int)(classInfo->AllocPerMSec * 10), 1000);
+			if (classInfo->SamplingRate == 1)
+				classInfo->SamplingRate = 0;
+		}
+
+		// We are done calculating the sampling rate since we are logging an event we can reset the 'Ignored' stats and log the event.  
+		representativeSize = classInfo->IgnoredSize;
+		classInfo->AllocsIgnored = 0;
+		classInfo->IgnoredSize = 0;
+	}
+	EventWriteObjectAllocatedEvent(objectId, classId, size, representativeSize);
+
+Done:
+	LeaveCriticalSection(&m_lock);
+	return S_OK;
+}
+
+//==============================================================================
+STDMETHODIMP CorProfilerTracer::GarbageCollectionStarted(int cGenerations, BOOL generationCollected[], COR_PRF_GC_REASON reason)
+{
+	LOG_TRACE(L"GC Started\n");
+	int maxGenCollected = 0;
+	for (int i = 0; i < cGenerations; i++)
+		if (generationCollected[i])
+			maxGenCollected = i;
+
+	m_gcCount++;
+
+	// Clear (but keep the memory) the survivor ranges, MovedReferences and SurvivingReferences refill it.  
+	// Only a full GC reports every live object, and after a younger GC its survivors have been promoted into the 
+	// next generation (so the condemned one would look almost empty), so we only look at fragmentation in full GCs.  
+	EnterCriticalSection(&m_lock);
+	m_survivorRanges.clear();
+	LeaveCriticalSection(&m_lock);
+	m_analyzeFragmentation = ((m_currentKeywords & GCFragmentationKeyword) != 0 && maxGenCollected >= 2);
+
+	// We look for duplicate strings in full GCs (which walk the whole heap).  
+	m_analyzeStrings = ((m_currentKeywords & DuplicateStringsKeyword) != 0 && maxGenCollected >= 2);
+	if (m_analyzeStrings)
+	{
+		m_stringSketch.assign(DuplicateStringSketchDepth * DuplicateStringSketchWidth, 0);
+		m_stringCandidates.assign(DuplicateStringCandidates, DuplicateStringCandidate());
+	}
+
+	m_analyzeArrays = ((m_currentKeywords & ArrayWasteKeyword) != 0 && maxGenCollected >= 2);
+	m_arrayScanBudget = ArrayWasteScanBudget;
+
+	// For GCPromotion we remember where the oldest condemned generation is before the GC, so we know which survivors came from it.  
+	m_promotionGeneration = -1;
+	m_promotedRanges.clear();
+	if ((m_currentKeywords & GCPromotionKeyword) != 0 && maxGenCollected <= 1)
+	{
+		ULONG boundsCount = 0;
+		if (GetGenerationBounds(m_promotionBounds, &boundsCount))
+		{
+			m_promotionBounds.resize(boundsCount);
+			m_promotionBounds.erase(std::remove_if(m_promotionBounds.begin(), m_promotionBounds.end(),
+				[maxGenCollected](const COR_PRF_GC_GENERATION_RANGE& bounds) { return bounds.generation != maxGenCollected; }), m_promotionBounds.end());
+			m_promotionGeneration = maxGenCollected;
+		}
+	}
+
+	// For GCPauses, a GC that starts while the runtime is suspended is part of that pause.  
+	if (m_suspendFinishTicks != 0)
+	{
+		m_gcStartTicks = __rdtsc();
+		m_pauseGCCount = m_gcCount;
+	}
+
+	EventWriteGCStartEvent(m_gcCount, min(maxGenCollected, 2), reason == COR_PRF_GC_INDUCED);
+
+	return S_OK;
+}
+
+//==============================================================================
+STDMETHODIMP CorProfilerTracer::GarbageCollectionFinished(void)
+{
+	LOG_TRACE(L"GC End\r\n");
+	if (m_gcStartTicks != 0 && m_gcFinishTicks == 0)
+		m_gcFinishTicks = __rdtsc();
+	if (m_analyzeFragmentation)
+		LogGCFragmentation();
+	if ((m_currentKeywords & FinalizerSummaryKeyword) != 0)
+		LogFinalizerSummary();
+	if (m_promotionGeneration >= 0)
+		LogGCPromotion();
+	if (m_analyzeStrings)
+		LogDuplicateStrings();
+	if (m_analyzeArrays)
+		LogArrayWaste();
+	if (!m_heapSampleClasses.empty())
+		LogHeapSampleSummary();
+	if ((m_currentKeywords & GCHandleSummaryKeyword) != 0 && GetTickCount() - m_lastHandleSummaryTick >= HandleSummaryIntervalMSec)
+		LogHandleSummary();
+	EventWriteGCStopEvent(m_gcCount);
+	return S_OK;
+}
+
+//==============================================================================
+// For GCPauses, we time each runtime suspension: suspending the threads, the GC (if there is one) and resuming them.  
+// The runtime suspends for one thing at a time, so these are only called by one thread at a time.  
+STDMETHODIMP CorProfilerTracer::RuntimeSuspendStarted(COR_PRF_SUSPEND_REASON suspendReason)
+{
+	if ((m_currentKeywords & (GCPausesKeyword | SafePointsKeyword)) == 0)
+		return S_OK;
+	EnterCriticalSection(&m_safePointLock);
+	m_safePoints.clear();
+	LeaveCriticalSection(&m_safePointLock);
+	m_suspendReason = suspendReason;
+	m_suspendFinishTicks = 0;
+	m_gcStartTicks = 0;
+	m_gcFinishTicks = 0;
+	m_resumeStartTicks = 0;
+	m_pauseGCCount = 0;
+	m_suspendStartTicks = __rdtsc();
+	return S_OK;
+}
+
+STDMETHODIMP CorProfilerTracer::RuntimeSuspendFinished()
+{
+	if (m_suspendStartTicks == 0)
+		return S_OK;
+	m_suspendFinishTicks = __rdtsc();
+	if ((m_currentKeywords & SafePointsKeyword) != 0)
+		LogSafePoints();
+	return S_OK;
+}
+
+STDMETHODIMP CorProfilerTracer::RuntimeSuspendAborted()
+{
+	m_suspendStartTicks = 0;
+	m_suspendFinishTicks = 0;
+	return S_OK;
+}
+
+STDMETHODIMP CorProfilerTracer::RuntimeResumeStarted()
+{
+	if (m_suspendFinishTicks != 0)
+		m_resumeStartTicks = __rdtsc();
+	return S_OK;
+}
+
+STDMETHODIMP CorProfilerTracer::RuntimeResumeFinished()
+{
+	if (m_resumeStartTicks == 0)
+		return S_OK;
+	ULONGLONG now = __rdtsc();
+	ULONGLONG phaseTicks[PausePhaseCount];
+	phaseTicks[PauseSuspend] = m_suspendFinishTicks - m_suspendStartTicks;
+	phaseTicks[PauseGC] = (m_gcFinishTicks != 0) ? m_gcFinishTicks - m_gcStartTicks : 0;
+	phaseTicks[PauseResume] = now - m_resumeStartTicks;
+	phaseTicks[PauseTotal] = now - m_suspendStartTicks;
+	int gcCount = (m_gcFinishTicks != 0) ? m_pauseGCCount : 0;
+	m_suspendStartTicks = 0;
+	m_suspendFinishTicks = 0;
+	m_gcStartTicks = 0;
+	m_gcFinishTicks = 0;
+	m_resumeStartTicks = 0;
+	if ((m_currentKeywords & GCPausesKeyword) == 0)
+		return S_OK;
+
+	ULONG reason = (ULONG)m_suspendReason < SuspendReasonCount ? (ULONG)m_suspendReason : (ULONG)COR_PRF_SUSPEND_OTHER;
+	for (int phase = 0; phase < PausePhaseCount; phase++)
+	{
+		// Suspensions that are not for a GC have no GC phase.  
+		if (phase == PauseGC && gcCount == 0)
+			continue;
+		MethodLatencyHistogram*& histogram = m_pauseHistograms[reason * PausePhaseCount + phase];
+		if (histogram == NULL)
+			histogram = new MethodLatencyHistogram(0, L"GCPause");
+		histogram->Add(phaseTicks[phase]);
+	}
+
+	EventWriteGCPauseEvent(TscTicksPerSecond(), gcCount, reason, phaseTicks[PauseSuspend], phaseTicks[PauseGC], phaseTicks[PauseResume], phaseTicks[PauseTotal]);
+	if (GetTickCount() - m_lastPauseHistogramTick >= GCPauseHistogramIntervalMSec)
+		LogGCPauseHistograms();
+	return S_OK;
+}
+
+//==============================================================================
+// For SafePoints, we remember when each thread was suspended while the runtime is suspending.  This can be called on 
+// the thread being suspended as well as the one suspending it.  
+STDMETHODIMP CorProfilerTracer::RuntimeThreadSuspended(ThreadID threadId)
+{
+	if (m_suspendStartTicks == 0 || m_suspendFinishTicks != 0 || (m_currentKeywords & SafePointsKeyword) == 0)
+		return S_OK;
+	ULONGLONG now = __rdtsc();
+	EnterCriticalSection(&m_safePointLock);
+	m_safePoints.push_back(std::make_pair(threadId, now));
+	LeaveCriticalSection(&m_safePointLock);
+	return S_OK;
+}
+
+//==============================================================================
+// Logs a GCPauseHistogram event for every suspend reason and phase we have seen.  
+void CorProfilerTracer::LogGCPauseHistograms()
+{
+	m_lastPauseHistogramTick = GetTickCount();
+	ULONGLONG ticksPerSecond = TscTicksPerSecond();
+	unsigned short bucketIndexes[LatencyBucketCount];
+	ULONGLONG bucketCounts[LatencyBucketCount];
+	for (ULONG reason = 0; reason < SuspendReasonCount; reason++)
+	{
+		for (ULONG phase = 0; phase < PausePhaseCount; phase++)
+		{
+			MethodLatencyHistogram* histogram = m_pauseHistograms[reason * PausePhaseCount + phase];
+			if (histogram == NULL || histogram->Count == 0)
+				continue;
+			ULONG bucketCount = histogram->GetBuckets(bucketIndexes, bucketCounts);
+			EventWriteGCPauseHistogramEvent(ticksPerSecond, reason, phase, LatencySubBucketBits, histogram->Count, histogram->SumTicks, 
+				histogram->MaxTicks, bucketCount, bucketIndexes, bucketCounts);
+		}
+	}
+}
+
+//==============================================================================
+STDMETHODIMP CorProfilerTracer::FinalizeableObjectQueued(DWORD finalizerFlags, ObjectID objectID)
+{
+	UNREFERENCED_PARAMETER(finalizerFlags);
+
+	LOG_TRACE(L"FinalizeableObjectQueued\n");
+#ifndef PIN_INVESTIGATION
+	// TODO FIX NOW HACK for exchange data collection 
+	ClassID classID = 0;
+	m_info->GetClassFromObject(objectID, &classID);
+	if ((m_currentKeywords & (GCKeyword | GCAllocKeyword | GCAllocSampledKeyword)) != 0)
+		EventWriteFinalizeableObjectQueuedEvent(objectID, classID);
+
+	// For the summary we just count them by type, and log the types with the most at the end of the GC. 
+	if ((m_currentKeywords & FinalizerSummaryKeyword) != 0 && classID != 0)
+	{
+		EnterCriticalSection(&m_lock);
+		ClassInfo* classInfo = GetClassInfo(classID);
+		if (classInfo != NULL && classInfo->FinalizeQueuedCount++ == 0)
+			m_finalizedClasses.push_back(classInfo);
+		LeaveCriticalSection(&m_lock);
+	}
+#endif
+	return S_OK;
+}
+
+//==============================================================================
+STDMETHODIMP CorProfilerTracer::MovedReferences(ULONG cMovedObjectIDRanges, ObjectID oldObjectIDRangeStart[], ObjectID newObjectIDRangeStart[], ULONG cObjectIDRangeLength[])
+{
+	LOG_TRACE(L"Moved Ref\n");
+	const int maxCount = MaxEventPayload / (1 * sizeof(int) + 2 * sizeof(void*));
+	for (ULONG idx = 0; idx < cMovedObjectIDRanges; idx += maxCount)
+	{
+		EventWriteObjectsMovedEvent(min(cMovedObjectIDRanges - idx, maxCount),
+			(const void**)&oldObjectIDRangeStart[idx], (const void**)&newObjectIDRangeStart[idx], (const unsigned int*)&cObjectIDRangeLength[idx]);
+	}
+
+	// For fragmentation we care where the objects end up.  
+	if (m_analyzeFragmentation)
+	{
+		EnterCriticalSection(&m_lock);
+		for (ULONG idx = 0; idx < cMovedObjectIDRanges; idx++)
+		{
+			ObjectRange range = { newObjectIDRangeStart[idx], cObjectIDRangeLength[idx] };
+			m_survivorRanges.push_back(range);
+		}
+		LeaveCriticalSection(&m_lock);
+	}
+
+	// For promotion we decide using where the objects were, but look at them where they end up (after the GC).  
+	if (m_promotionGeneration >= 0)
+	{
+		EnterCriticalSection(&m_lock);
+		for (ULONG idx = 0; idx < cMovedObjectIDRanges; idx++)
+		{
+			if (InPromotionBounds(oldObjectIDRangeStart[idx]))
+			{
+				ObjectRange range = { newObjectIDRangeStart[idx], cObjectIDRangeLength[idx] };
+				m_promotedRanges.push_back(range);
+			}
+		}
+		LeaveCriticalSection(&m_lock);
+	}
+	return S_OK;
+}
+
+//==============================================================================
+STDMETHODIMP CorProfilerTracer::SurvivingReferences(ULONG cSurvivingObjectIDRanges, ObjectID objectIDRangeStart[], ULONG cObjectIDRangeLength[])
+{
+	LOG_TRACE(L"Surviving references\n");
+	const int maxCount = MaxEventPayload / (1 * sizeof(int) + 1 * sizeof(void*));
+	for (ULONG idx = 0; idx < cSurvivingObjectIDRanges; idx += maxCount)
+	{
+		EventWriteObjectsSurvivedEvent(min(cSurvivingObjectIDRanges - idx, maxCount),
+			(const void**)&objectIDRangeStart[idx], (const unsigned int*)&cObjectIDRangeLength[idx]);
+	}
+
+	if (m_analyzeFragmentation)
+	{
+		EnterCriticalSection(&m_lock);
+		for (ULONG idx = 0; idx < cSurvivingObjectIDRanges; idx++)
+		{
+			ObjectRange range = { objectIDRangeStart[idx], cObjectIDRangeLength[idx] };
+			m_survivorRanges.push_back(range);
+		}
+		LeaveCriticalSection(&m_lock);
+	}
+
+	if (m_promotionGeneration >= 0)
+	{
+		EnterCriticalSection(&m_lock);
+		for (ULONG idx = 0; idx < cSurvivingObjectIDRanges; idx++)
+		{
+			if (InPromotionBounds(objectIDRangeStart[idx]))
+			{
+				ObjectRange range = { objectIDRangeStart[idx], cObjectIDRangeLength[idx] };
+				m_promotedRanges.push_back(range);
+			}
+		}
+		LeaveCriticalSection(&m_lock);
+	}
+	return S_OK;
+}
+
+//==============================================================================
+// Called at the end of a full GC when the GCFragmentation keyword is on.  Intersects the survivor 
+// ranges collected during the GC with the (post GC) generation bounds and logs, for each generation (a full GC 
+// condemns them all, so all their live objects were reported), how much of it is free, the size of 
+// the largest free block and a histogram of the free gaps.  
+void CorProfilerTracer::LogGCFragmentation()
+{
+	// Sort and coalesce the survivor ranges in place.  ClearTables can clear them from the ETW thread, so we hold 
+	// m_lock while we use them.  
+	EnterCriticalSection(&m_lock);
+	std::sort(m_survivorRanges.begin(), m_survivorRanges.end(), [](const ObjectRange& a, const ObjectRange& b) { return a.Start < b.Start; });
+	size_t mergedCount = 0;
+	for (size_t i = 0; i < m_survivorRanges.size(); i++)
+	{
+		const ObjectRange& range = m_survivorRanges[i];
+		if (mergedCount > 0)
+		{
+			ObjectRange& last = m_survivorRanges[mergedCount - 1];
+			if (range.Start <= last.Start + last.Length)
+			{
+				if (range.Start + range.Length > last.Start + last.Length)
+					last.Length = range.Start + range.Length - last.Start;
+				continue;
+			}
+		}
+		m_survivorRanges[mergedCount++] = range;
+	}
+	m_survivorRanges.resize(mergedCount);
+
+	ULONG boundsCount = 0;
+	if (!GetGenerationBounds(m_generationBounds, &boundsCount))
+	{
+		LeaveCriticalSection(&m_lock);
+		return;
+	}
+
+	struct FragmentationStats
+	{
+		ULONGLONG RangeSize;
+		ULONGLONG LiveSize;
+		ULONGLONG LargestFreeBlock;
+		unsigned int GapCounts[FragmentationBucketCount];
+		ULONGLONG GapSizes[FragmentationBucketCount];
+	};
+	const int generationCount = COR_PRF_GC_LARGE_OBJECT_HEAP + 1;
+	FragmentationStats stats[generationCount];
+	memset(stats, 0, sizeof(stats));
+
+	for (ULONG i = 0; i < boundsCount; i++)
+	{
+		const COR_PRF_GC_GENERATION_RANGE& bounds = m_generationBounds[i];
+		int generation = bounds.generation;
+		if (generation < 0 || generationCount <= generation)
+			continue;
+
+		FragmentationStats& genStats = stats[generation];
+		ObjectID rangeStart = bounds.rangeStart;
+		ObjectID rangeEnd = rangeStart + bounds.rangeLength;
+		genStats.RangeSize += bounds.rangeLength;
+
+		// Find the first survivor range that ends after the start of this generation range. 
+		auto survivor = std::lower_bound(m_survivorRanges.begin(), m_survivorRanges.end(), rangeStart,
+			[](const ObjectRange& range, ObjectID address) { return range.Start + range.Length <= address; });
+
+		ObjectID cursor = rangeStart;
+		for (;;)
+		{
+			ObjectID liveStart = rangeEnd;
+			ObjectID liveEnd = rangeEnd;
+			if (survivor != m_survivorRanges.end() && survivor->Start < rangeEnd)
+			{
+				liveStart = max(survivor->Start, rangeStart);
+				liveEnd = min(survivor->Start + survivor->Length, rangeEnd);
+			}
+
+			if (cursor < liveStart)
+			{
+				ULONGLONG gapSize = liveStart - cursor;
+				int bucket = 0;
+				while (bucket < FragmentationBucketCount - 1 && (gapSize >> (bucket + 1)) != 0)
+					bucket++;
+				genStats.GapCounts[bucket]++;
+				genStats.GapSizes[bucket] += gapSize;
+				if (gapSize > genStats.LargestFreeBlock)
+					genStats.LargestFreeBlock = gapSize;
+			}
+
+			if (liveStart == rangeEnd)
+				break;
+			genStats.LiveSize += liveEnd - liveStart;
+			cursor = liveEnd;
+			survivor++;
+		}
+	}
+	LeaveCriticalSection(&m_lock);
+
+	for (int generation = 0; generation < generationCount; generation++)
+	{
+		FragmentationStats& genStats = stats[generation];
+		if (genStats.RangeSize == 0)
+			continue;
+		EventWriteGCFragmentationEvent(m_gcCount, generation, genStats.RangeSize, genStats.LiveSize, genStats.RangeSize - genStats.LiveSize,
+			genStats.LargestFreeBlock, FragmentationBucketCount, genStats.GapCounts, genStats.GapSizes);
+	}
+}
+
+//==============================================================================
+STDMETHODIMP CorProfilerTracer::RootReferences2(ULONG cRootRefs, ObjectID rootRefIds[], COR_PRF_GC_ROOT_KIND rootKinds[], COR_PRF_GC_ROOT_FLAGS rootFlags[], UINT_PTR rootIds[])
+{
+	// If we did not ask for the GCHeap events, do nothing.  
+	if ((m_currentKeywords & (GCHeapKeyword | GCHeapSampledKeyword)) == 0)
+		return S_OK;
+
+	LOG_TRACE(L"RootReferences2\n");
+	const int maxCount = MaxEventPayload / (2 * sizeof(int) + 2 * sizeof(void*));
+	for (ULONG idx = 0; idx < cRootRefs; idx += maxCount)
+	{
+		EventWriteRootReferencesEvent(min(cRootRefs - idx, maxCount),
+			(const void**)&rootRefIds[idx], (unsigned int*)&rootKinds[idx], (unsigned int*)&rootFlags[idx], (const void**)&rootIds[idx]);
+	}
+	return S_OK;
+}
+
+//==============================================================================
+STDMETHODIMP CorProfilerTracer::ObjectReferences(ObjectID objectId, ClassID classId, ULONG cObjectRefs, ObjectID objectRefIds[])
+{
+	if ((m_currentKeywords & (GCHeapKeyword | GCHeapSampledKeyword)) == 0 && !m_analyzeStrings && !m_analyzeArrays)
+		return S_OK;
+	// LOG_TRACE(L"ObjectReferences\n");
+
+	// We do this for the side effect of logging the class  
+	ClassInfo* classInfo = GetClassInfo(classId);
+
+	if (m_analyzeStrings)
+	{
+		if (m_stringClassId == 0 && classInfo != NULL && wcscmp(classInfo->Name, L"System.String") == 0)
+			m_stringClassId = classId;
+		if (classId == m_stringClassId)
+			CountString(objectId);
+	}
+	if (m_analyzeArrays && classInfo != NULL && classInfo->IsArray)
+		ScanArray(objectId, classInfo);
+	if ((m_currentKeywords & GCHeapKeyword) == 0)
+	{
+		if ((m_currentKeywords & GCHeapSampledKeyword) == 0)
+			return S_OK;
+
+		// Pick the objects to log by a hash of their address, so that the choice does not depend on the order of the walk.  
+		ULONG hash = (ULONG)((((ULONGLONG)objectId >> 3) * 0x9E3779B97F4A7C15ULL) >> 32);
+		if (hash % m_heapSampleRate != 0)
+		{
+			if (classInfo != NULL)
+			{
+				ULONG unsampledSize = 0;
+				m_info->GetObjectSize(objectId, &unsampledSize);
+				if (classInfo->UnsampledCount++ == 0)
+					m_heapSampleClasses.push_back(classInfo);
+				classInfo->UnsampledSize += unsampledSize;
+			}
+			return S_OK;
+		}
+	}
+
+	/** TODO FIX NOW
+	if (classInfo == NULL)
+	return E_FAIL;
+	**/
+	ULONG size = 0;
+	m_info->GetObjectSize(objectId, &size);
+
+	EventWriteObjectReferencesEvent(objectId, classId, size, cObjectRefs, (const void**)objectRefIds);
+	return S_OK;
+}
+
+//==============================================================================
+STDMETHODIMP CorProfilerTracer::HandleCreated(GCHandleID handleId, ObjectID initialObjectId)
+{
+	if ((m_currentKeywords & (GCHeapKeyword | GCAllocKeyword | GCAllocSampledKeyword | GCHandleSummaryKeyword)) == 0)
+		return S_OK;
+
+	LOG_TRACE(L"HandleCreated\n");
+	if ((m_currentKeywords & GCHandleSummaryKeyword) != 0)
+	{
+		ClassID classId = 0;
+		if (initialObjectId != 0)
+			m_info->GetClassFromObject(initialObjectId, &classId);
+
+		EnterCriticalSection(&m_handleLock);
+		m_liveHandles->Add(handleId, classId, m_gcCount);
+		LeaveCriticalSection(&m_handleLock);
+	}
+#ifndef PIN_INVESTIGATION
+	// TODO FIX NOW HACK for exchange data collection 
+	EventWriteHandleCreatedEvent(handleId, initialObjectId);
+#endif
+	return S_OK;
+}
+
+//==============================================================================
+STDMETHODIMP CorProfilerTracer::HandleDestroyed(GCHandleID handleId)
+{
+	if ((m_currentKeywords & (GCHeapKeyword | GCAllocKeyword | GCAllocSampledKeyword | GCHandleSummaryKeyword)) == 0)
+		return S_OK;
+
+	LOG_TRACE(L"HandleDestroyed\n");
+	if ((m_currentKeywords & GCHandleSummaryKeyword) != 0)
+	{
+		EnterCriticalSection(&m_handleLock);
+		m_liveHandles->Remove(handleId);
+		LeaveCriticalSection(&m_handleLock);
+	}
+#ifndef PIN_INVESTIGATION
+	// TODO FIX NOW HACK for exchange data collection 
+	EventWriteHandleDestroyedEvent(handleId);
+#endif 
+	return S_OK;
+}
+
+//==============================================================================
+// Fetches the generation bounds into 'bounds', growing it only if it is too small (so it can be reused 
+// every GC).  On success *pBoundsCount is set to the number of valid entries.  
+bool CorProfilerTracer::GetGenerationBounds(std::vector<COR_PRF_GC_GENERATION_RANGE>& bounds, ULONG* pBoundsCount)
+{
+	if (bounds.size() < 16)
+		bounds.resize(16);
+	HRESULT hr = m_info->GetGenerationBounds((ULONG)bounds.size(), pBoundsCount, bounds.data());
+	if (hr == S_OK && *pBoundsCount > bounds.size())
+	{
+		bounds.resize(*pBoundsCount);
+		hr = m_info->GetGenerationBounds((ULONG)bounds.size(), pBoundsCount, bounds.data());
+	}
+	if (hr != S_OK)
+	{
+		EventWriteProfilerError(hr, L"GetGenerationBounds Failed");
+		return false;
+	}
+	return true;
+}
+
+//==============================================================================
+// Returns true if 'objectId' was (before the GC) in the generation whose survivors we are tracking for GCPromotion.  
+bool CorProfilerTracer::InPromotionBounds(ObjectID objectId)
+{
+	for (auto it = m_promotionBounds.begin(); it != m_promotionBounds.end(); ++it)
+	{
+		if (it->rangeStart <= objectId && objectId < it->rangeStart + it->rangeLength)
+			return true;
+	}
+	return false;
+}
+
+//==============================================================================
+// Called at the end of a gen 0 or gen 1 GC when the GCPromotion keyword is on.  Walks the objects that survived 
+// (were promoted out of) the oldest condemned generation, looks up the type of 1 in PromotionSampleRate of them 
+// and logs one GCPromotion event with the types that had the most sampled bytes promoted.  
+void CorProfilerTracer::LogGCPromotion()
+{
+	EnterCriticalSection(&m_lock);
+	unsigned int totalCount = 0;
+	ULONGLONG totalSize = 0;
+	for (auto rangeIt = m_promotedRanges.begin(); rangeIt != m_promotedRanges.end(); ++rangeIt)
+	{
+		ObjectID objectId = rangeIt->Start;
+		ObjectID rangeEnd = rangeIt->Start + (ObjectID) rangeIt->Length;
+		while (objectId < rangeEnd)
+		{
+			ULONG size = 0;
+			if (m_info->GetObjectSize(objectId, &size) != S_OK || size == 0)
+				break;
+
+			if (--m_promotionSampleCountdown == 0)
+			{
+				m_promotionSampleCountdown = PromotionSampleRate;
+				ClassID classId = 0;
+				if (m_info->GetClassFromObject(objectId, &classId) == S_OK && classId != 0)
+				{
+					ClassInfo* classInfo = GetClassInfo(classId);
+					if (classInfo != NULL)
+					{
+						if (classInfo->PromotedCount++ == 0)
+							m_promotedClasses.push_back(classInfo);
+						classInfo->PromotedSize += size;
+					}
+				}
+			}
+			totalCount++;
+			totalSize += size;
+			objectId += (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);		// Objects are pointer aligned.  
+		}
+	}
+
+	size_t typeCount = min(m_promotedClasses.size(), (size_t) PromotionTopN);
+	std::partial_sort(m_promotedClasses.begin(), m_promotedClasses.begin() + typeCount, m_promotedClasses.end(),
+		[](const ClassInfo* a, const ClassInfo* b) { return a->PromotedSize > b->PromotedSize; });
+
+	ULONGLONG classIds[PromotionTopN];
+	unsigned int objectCounts[PromotionTopN];
+	ULONGLONG objectSizes[PromotionTopN];
+	for (size_t i = 0; i < typeCount; i++)
+	{
+		ClassInfo* classInfo = m_promotedClasses[i];
+		classIds[i] = classInfo->ID;
+		objectCounts[i] = classInfo->PromotedCount;
+		objectSizes[i] = classInfo->PromotedSize;
+	}
+	EventWriteGCPromotionEvent(m_gcCount, m_promotionGeneration, PromotionSampleRate, totalCount, totalSize,
+		(unsigned int)typeCount, classIds, objectCounts, objectSizes);
+
+	for (auto it = m_promotedClasses.begin(); it != m_promotedClasses.end(); ++it)
+	{
+		(*it)->PromotedCount = 0;
+		(*it)->PromotedSize = 0;
+	}
+	m_promotedClasses.clear();
+	m_promotedRanges.clear();
+	m_promotionGeneration = -1;
+	LeaveCriticalSection(&m_lock);
+}
+
+//==============================================================================
+// Called for every string in the heap walk of a gen 2 GC when the DuplicateStrings keyword is on.  We don't 
+// keep the strings, we just hash their contents and count the hashes in a count-min sketch.   Strings that 
+// the sketch says we have seen more than once compete (by estimated count) for a slot in m_stringCandidates, 
+// and it is those slots that LogDuplicateStrings reports.  
+void CorProfilerTracer::CountString(ObjectID objectId)
+{
+	if (m_stringBufferOffset == 0)
+	{
+		HRESULT hr = m_info->GetStringLayout2(&m_stringLengthOffset, &m_stringBufferOffset);
+		if (hr != S_OK)
+		{
+			EventWriteProfilerError(hr, L"GetStringLayout2 Failed");
+			m_analyzeStrings = false;
+			return;
+		}
+	}
+
+	ULONG length = *(const DWORD*)(objectId + m_stringLengthOffset);
+	const BYTE* chars = (const BYTE*)(objectId + m_stringBufferOffset);
+	ULONGLONG hash = HashBytes(chars, length * sizeof(WCHAR));
+
+	// Conservative update: only bump the counters that are at the current minimum.  
+	ULONG hashLow = (ULONG)hash;
+	ULONG hashHigh = (ULONG)(hash >> 32) | 1;
+	unsigned int* counters[DuplicateStringSketchDepth];
+	unsigned int estimate = 0xFFFFFFFF;
+	for (int row = 0; row < DuplicateStringSketchDepth; row++)
+	{
+		ULONG column = (hashLow + row * hashHigh) & (DuplicateStringSketchWidth - 1);
+		counters[row] = &m_stringSketch[row * DuplicateStringSketchWidth + column];
+		estimate = min(estimate, *counters[row]);
+	}
+	estimate++;
+	for (int row = 0; row < DuplicateStringSketchDepth; row++)
+	{
+		if (*counters[row] < estimate)
+			*counters[row] = estimate;
+	}
+	if (estimate < 2)
+		return;
+
+	DuplicateStringCandidate& candidate = m_stringCandidates[(size_t)(hash >> 54) & (DuplicateStringCandidates - 1)];
+	if (candidate.Hash == hash)
+		candidate.Count = estimate;
+	else if (candidate.Count < estimate)
+	{
+		ULONG size = 0;
+		m_info->GetObjectSize(objectId, &size);
+		candidate.Hash = hash;
+		candidate.Instance = objectId;
+		candidate.Size = size;
+		candidate.Count = estimate;
+	}
+}
+
+//==============================================================================
+// Called at the end of a gen 2 GC when the DuplicateStrings keyword is on.  Logs the candidate strings 
+// with the most bytes wasted by duplicates.  The objects have not moved since the heap walk, so we
+// can read their values from the heap.  
+void CorProfilerTracer::LogDuplicateStrings()
+{
+	m_analyzeStrings = false;
+	auto wasted = [](const DuplicateStringCandidate& candidate) { return (ULONGLONG)(candidate.Count - 1) * candidate.Size; };
+	size_t topCount = min(m_stringCandidates.size(), (size_t) DuplicateStringTopN);
+	std::partial_sort(m_stringCandidates.begin(), m_stringCandidates.begin() + topCount, m_stringCandidates.end(),
+		[&wasted](const DuplicateStringCandidate& a, const DuplicateStringCandidate& b) { return wasted(a) > wasted(b); });
+
+	wchar_t value[DuplicateStringMaxChars + 1];
+	for (size_t i = 0; i < topCount; i++)
+	{
+		const DuplicateStringCandidate& candidate = m_stringCandidates[i];
+		if (candidate.Count < 2)
+			break;
+
+		ULONG length = *(const DWORD*)(candidate.Instance + m_stringLengthOffset);
+		ULONG copyLength = min(length, (ULONG) DuplicateStringMaxChars);
+		memcpy_s(value, sizeof(value), (const void*)(candidate.Instance + m_stringBufferOffset), copyLength * sizeof(wchar_t));
+		value[copyLength] = 0;
+		EventWriteDuplicateStringEvent(m_gcCount, (unsigned int)i, candidate.Count, length, wasted(candidate), value);
+	}
+}
+
+//==============================================================================
+// Called for every array in the heap walk of a gen 2 GC when the ArrayWaste keyword is on.  For arrays at least 
+// m_arrayWasteMinSize bytes, counts the zero bytes in the array's data (and how many of them are at the end) 
+// into its ClassInfo, until the GC's scan budget runs out.  
+void CorProfilerTracer::ScanArray(ObjectID objectId, ClassInfo* classInfo)
+{
+	ULONG size = 0;
+	m_info->GetObjectSize(objectId, &size);
+	if (size < m_arrayWasteMinSize || ArrayMaxRank < classInfo->rank)
+		return;
+
+	if (classInfo->ArrayScanCount == 0 && classInfo->ArraySkippedCount == 0)
+		m_arrayWasteClasses.push_back(classInfo);
+
+	ULONG32 dimensions[ArrayMaxRank];
+	int lowerBounds[ArrayMaxRank];
+	BYTE* arrayData = NULL;
+	if (m_arrayScanBudget < size || m_info->GetArrayObjectInfo(objectId, classInfo->rank, dimensions, lowerBounds, &arrayData) != S_OK ||
+		(ObjectID)arrayData < objectId || objectId + size < (ObjectID)arrayData)
+	{
+		classInfo->ArraySkippedCount++;
+		return;
+	}
+	m_arrayScanBudget -= size;
+
+	size_t dataSize = (size_t)(objectId + size - (ObjectID)arrayData);
+	classInfo->ArrayScanCount++;
+	classInfo->ArrayScanBytes += dataSize;
+	classInfo->ArrayZeroBytes += s_cpuHasAvx2 ? CountZeroBytesAvx2(arrayData, dataSize) : CountZeroBytesSse2(arrayData, dataSize);
+	classInfo->ArrayTrailingZeroBytes += CountTrailingZeroBytes(arrayData, dataSize);
+}
+
+//==============================================================================
+// Logs an ArrayWaste event for every array type that had large arrays in this GC, and resets the counts.  
+void CorProfilerTracer::LogArrayWaste()
+{
+	m_analyzeArrays = false;
+	for (auto it = m_arrayWasteClasses.begin(); it != m_arrayWasteClasses.end(); ++it)
+	{
+		ClassInfo* classInfo = *it;
+		EventWriteArrayWasteEvent(m_gcCount, classInfo->ID, classInfo->ArrayScanCount, classInfo->ArraySkippedCount,
+			classInfo->ArrayScanBytes, classInfo->ArrayZeroBytes, classInfo->ArrayTrailingZeroBytes);
+
+		classInfo->ArrayScanCount = 0;
+		classInfo->ArraySkippedCount = 0;
+		classInfo->ArrayScanBytes = 0;
+		classInfo->ArrayZeroBytes = 0;
+		classInfo->ArrayTrailingZeroBytes = 0;
+	}
+	m_arrayWasteClasses.clear();
+}
+
+//==============================================================================
+// Logs the HeapSampleSummary events (the per type totals of the objects GCHeapSampled did not log) for this 
+// GC, batched to fit in ETW events, and resets the counts.  
+void CorProfilerTracer::LogHeapSampleSummary()
+{
+	m_heapSampleClassIds.clear();
+	m_heapSampleCounts.clear();
+	m_heapSampleSizes.clear();
+	for (auto it = m_heapSampleClasses.begin(); it != m_heapSampleClasses.end(); ++it)
+	{
+		ClassInfo* classInfo = *it;
+		m_heapSampleClassIds.push_back(classInfo->ID);
+		m_heapSampleCounts.push_back(classInfo->UnsampledCount);
+		m_heapSampleSizes.push_back(classInfo->UnsampledSize);
+		classInfo->UnsampledCount = 0;
+		classInfo->UnsampledSize = 0;
+	}
+	m_heapSampleClasses.clear();
+
+	const int maxCount = MaxEventPayload / (1 * sizeof(int) + 2 * sizeof(ULONGLONG));
+	ULONG classCount = (ULONG)m_heapSampleClassIds.size();
+	for (ULONG idx = 0; idx < classCount; idx += maxCount)
+	{
+		EventWriteHeapSampleSummaryEvent(m_gcCount, m_heapSampleRate, min(classCount - idx, maxCount),
+			&m_heapSampleClassIds[idx], &m_heapSampleCounts[idx], &m_heapSampleSizes[idx]);
+	}
+}
+
+//==============================================================================
+// Called (by EnterMethod) the first time a thread counts a call, to create the thread's CallCountTable.  We 
+// remember them by managed thread so that LogCallCounts can add them up, and ThreadDestroyed can free them.  
+CallCountTable* CorProfilerTracer::NewCallCountTable()
+{
+	ThreadID threadId = 0;
+	m_info->GetCurrentThreadID(&threadId);
+	CallCountTable* table = new CallCountTable();
+	table->Generation = CallCountGeneration;
+	EnterCriticalSection(&m_callCountLock);
+	m_callCountTables[threadId] = table;
+	LeaveCriticalSection(&m_callCountLock);
+	return table;
+}
+
+//==============================================================================
+// Logs CallCounts events with the total (over all threads) number of calls to each method so far.  
+void CorProfilerTracer::LogCallCounts()
+{
+	EnterCriticalSection(&m_callCountLock);
+	std::unordered_map<FunctionID, ULONGLONG> totals(m_deadThreadCallCounts);
+	for (auto it = m_callCountTables.begin(); it != m_callCountTables.end(); ++it)
+	{
+		// A table from before CallCount was last turned on is cleared by its thread on its next call.  
+		if (it->second->Generation == CallCountGeneration)
+			it->second->AddTo(totals);
+	}
+
+	std::vector<ULONGLONG> functionIds;
+	std::vector<ULONGLONG> callCounts;
+	functionIds.reserve(totals.size());
+	callCounts.reserve(totals.size());
+	for (auto it = totals.begin(); it != totals.end(); ++it)
+	{
+		functionIds.push_back(it->first);
+		callCounts.push_back(it->second);
+	}
+	LeaveCriticalSection(&m_callCountLock);
+	DefineFunctions(functionIds.data(), functionIds.size());
+
+	const int maxCount = MaxEventPayload / (2 * sizeof(ULONGLONG));
+	ULONG functionCount = (ULONG)functionIds.size();
+	for (ULONG idx = 0; idx < functionCount; idx += maxCount)
+		EventWriteCallCountsEvent(min(functionCount - idx, maxCount), &functionIds[idx], &callCounts[idx]);
+}
+
+//==============================================================================
+// Called (by EnterMethod) the first time a thread samples a call with CallGraph on, to create the thread's table of call edges.  
+CallCountTable* CorProfilerTracer::NewCallEdgeTable()
+{
+	CallCountTable* table = new CallCountTable();
+	EnterCriticalSection(&m_callCountLock);
+	m_callEdgeTables.push_back(table);
+	LeaveCriticalSection(&m_callCountLock);
+	return table;
+}
+
+//==============================================================================
+// Used by the hooks to find the method an IP is in (returns false if it is not in managed code).  
+bool CorProfilerTracer::GetFunctionFromIP(UINT_PTR ip, FunctionID* functionId)
+{
+	return m_info->GetFunctionFromIP((LPCBYTE)ip, functionId) == S_OK;
+}
+
+//==============================================================================
+// Logs CallEdges events with the total (over all threads) number of samples of each caller to callee edge so far.  
+void CorProfilerTracer::LogCallEdges()
+{
+	EnterCriticalSection(&m_callCountLock);
+	std::map<std::pair<FunctionID, FunctionID>, ULONGLONG> totals;
+	for (auto it = m_callEdgeTables.begin(); it != m_callEdgeTables.end(); ++it)
+		(*it)->AddEdgesTo(totals);
+	LeaveCriticalSection(&m_callCountLock);
+
+	std::vector<ULONGLONG> callerIds;
+	std::vector<ULONGLONG> calleeIds;
+	std::vector<ULONGLONG> sampleCounts;
+	callerIds.reserve(totals.size());
+	calleeIds.reserve(totals.size());
+	sampleCounts.reserve(totals.size());
+	for (auto it = totals.begin(); it != totals.end(); ++it)
+	{
+		callerIds.push_back(it->first.first);
+		calleeIds.push_back(it->first.second);
+		sampleCounts.push_back(it->second);
+	}
+	DefineFunctions(callerIds.data(), callerIds.size());
+	DefineFunctions(calleeIds.data(), calleeIds.size());
+
+	const ULONG samplingRate = CallSamplingRate * CallEventRate;
+	const int maxCount = MaxEventPayload / (3 * sizeof(ULONGLONG));
+	ULONG edgeCount = (ULONG)callerIds.size();
+	for (ULONG idx = 0; idx < edgeCount; idx += maxCount)
+		EventWriteCallEdgesEvent(samplingRate, min(edgeCount - idx, maxCount), &callerIds[idx], &calleeIds[idx], &sampleCounts[idx]);
+}
+
+//==============================================================================
+// Called the first time a thread logs a CallStackSample, to create the thread's cache of return addresses.  
+FrameCacheEntry* CorProfilerTracer::NewFrameCache()
+{
+	FrameCacheEntry* cache = new FrameCacheEntry[FrameCacheSize];
+	memset(cache, 0, FrameCacheSize * sizeof(FrameCacheEntry));
+	EnterCriticalSection(&m_callCountLock);
+	m_frameCaches.push_back(cache);
+	LeaveCriticalSection(&m_callCountLock);
+	return cache;
+}
+
+//==============================================================================
+// Returns the ID of the call stack 'frames' (FunctionIDs, innermost first).  The first time we see a stack we log 
+// its StackDefinition event (and the FunctionIDDefinitions of its methods).  Can be called from any thread.  
+ULONG CorProfilerTracer::InternStack(const ULONGLONG* frames, ULONG count)
+{
+	bool isNew = false;
+	ULONG stackId = m_stacks->Intern(frames, count, &isNew);
+	if (isNew)
+	{
+		DefineFunctions(frames, count);
+		EventWriteStackDefinitionEvent(stackId, count, frames);
+	}
+	return stackId;
+}
+
+//==============================================================================
+// Called (by EnterMethod) the first time a thread enters a method with CallTree on, to create the thread's CallTree.  
+// Like the call count tables, we remember them by managed thread.  
+CallTree* CorProfilerTracer::NewCallTree()
+{
+	ThreadID threadId = 0;
+	m_info->GetCurrentThreadID(&threadId);
+	CallTree* tree = new CallTree();
+	EnterCriticalSection(&m_callCountLock);
+	m_callTrees[threadId] = tree;
+	LeaveCriticalSection(&m_callCountLock);
+	return tree;
+}
+
+//==============================================================================
+// Logs CallTree events with the calling context trees of all the threads merged into one.  
+void CorProfilerTracer::LogCallTree()
+{
+	std::vector<CallTree::Node> merged;
+	std::map<std::pair<ULONG, FunctionID>, ULONG> index;
+	CallTree::Node root = {};
+	merged.push_back(root);
+
+	EnterCriticalSection(&m_callCountLock);
+	m_deadThreadCallTree->AddTo(merged, index);
+	for (auto it = m_callTrees.begin(); it != m_callTrees.end(); ++it)
+		it->second->AddTo(merged, index);
+	ULONG flushId = m_callTreeFlushCount++;
+	LeaveCriticalSection(&m_callCountLock);
+	ULONGLONG ticksPerSecond = TscTicksPerSecond();
+
+	ULONG nodeCount = (ULONG)merged.size() - 1;
+	std::vector<ULONG> nodeIds(nodeCount), parentIds(nodeCount);
+	std::vector<ULONGLONG> functionIds(nodeCount), calls(nodeCount), inclusiveTicks(nodeCount), exclusiveTicks(nodeCount);
+	for (ULONG i = 0; i < nodeCount; i++)
+	{
+		const CallTree::Node& node = merged[i + 1];
+		nodeIds[i] = i + 1;
+		parentIds[i] = node.Parent;
+		functionIds[i] = node.ID;
+		calls[i] = node.Calls;
+		inclusiveTicks[i] = node.InclusiveTicks;
+		exclusiveTicks[i] = node.ExclusiveTicks;
+	}
+	DefineFunctions(functionIds.data(), functionIds.size());
+
+	const int maxCount = MaxEventPayload / (2 * sizeof(ULONG) + 4 * sizeof(ULONGLONG));
+	for (ULONG idx = 0; idx < nodeCount; idx += maxCount)
+	{
+		EventWriteCallTreeEvent(flushId, ticksPerSecond, min(nodeCount - idx, maxCount), &nodeIds[idx], &parentIds[idx],
+			&functionIds[idx], &calls[idx], &inclusiveTicks[idx], &exclusiveTicks[idx]);
+	}
+}
+
+//==============================================================================
+// Returns how fast the time stamp counter ticks, found by comparing it to QueryPerformanceCounter since we started.  
+ULONGLONG CorProfilerTracer::TscTicksPerSecond()
+{
+	LARGE_INTEGER qpcNow, qpcFrequency;
+	QueryPerformanceCounter(&qpcNow);
+	QueryPerformanceFrequency(&qpcFrequency);
+	ULONGLONG tscElapsed = __rdtsc() - m_tscStartTsc;
+	LONGLONG qpcElapsed = qpcNow.QuadPart - m_tscStartQpc.QuadPart;
+	if (qpcElapsed <= 0)
+		return 0;
+	return (ULONGLONG)((double)tscElapsed * qpcFrequency.QuadPart / qpcElapsed);
+}
+
+//==============================================================================
+// Returns true if 'name' matches one of the ';' separated wildcard 'patterns'.  
+static bool MatchesPatterns(const wchar_t* patterns, const wchar_t* name)
+{
+	const wchar_t* pattern = patterns;
+	while (*pattern != 0)
+	{
+		const wchar_t* patternEnd = wcschr(pattern, L';');
+		if (patternEnd == NULL)
+			patternEnd = pattern + wcslen(pattern);
+		if (patternEnd != pattern && WildcardMatch(pattern, patternEnd, name))
+			return true;
+		pattern = (*patternEnd != 0) ? patternEnd + 1 : patternEnd;
+	}
+	return false;
+}
+
+//==============================================================================
+// Gets the Type.Method name of the method 'token' in the module whose metadata is 'metaDataImport'.  If that does not 
+// fit in 'nameCount' characters it is truncated (wcscat_s would end the process instead).  
+static bool GetMethodName(IMetaDataImport* metaDataImport, mdMethodDef token, wchar_t* name, ULONG nameCount)
+{
+	wchar_t methodName[MethodNameMaxChars];
+	ULONG nameLength = 0;
+	mdTypeDef typeDef = 0;
+	DWORD flags = 0;
+	mdToken baseClass = 0;
+	if (metaDataImport->GetMethodProps(token, &typeDef, methodName, _countof(methodName), &nameLength, NULL, NULL, NULL, NULL, NULL) != S_OK ||
+		metaDataImport->GetTypeDefProps(typeDef, name, nameCount, &nameLength, &flags, &baseClass) != S_OK)
+		return false;
+	wcsncat_s(name, nameCount, L".", _TRUNCATE);
+	wcsncat_s(name, nameCount, methodName, _TRUNCATE);
+	return true;
+}
+
+//==============================================================================
+// Like GetClassInfo, but for methods.  The first time we see a method we log a FunctionIDDefinition event for it. 
+// The caller must hold m_lock.  
+FunctionInfo* CorProfilerTracer::GetFunctionInfo(FunctionID functionId)
+{
+	// Have I already looked up this method? 
+	FunctionInfo*& functionInfo = m_functionInfo[functionId];
+	if (functionInfo == NULL)
+		functionInfo = new FunctionInfo();
+	if (functionInfo->ID == static_cast<FunctionID>(-1))     // We failed to get info on the method.
+		return NULL;
+	if (functionInfo->ID == 0)
+	{
+		functionInfo->ID = static_cast<FunctionID>(-1);
+		ModuleID moduleId = 0;
+		HRESULT hr = m_info->GetFunctionInfo2(functionId, 0, &functionInfo->Class, &moduleId, &functionInfo->Token, 0, NULL, NULL);
+		if (hr == S_OK && moduleId != 0)
+		{
+			ModuleInfo* moduleInfo = functionInfo->ModuleInfo = GetModuleInfo(moduleId);
+			wchar_t name[MethodNameMaxChars];
+			if (moduleInfo != NULL && GetMethodName(moduleInfo->MetaDataImport, functionInfo->Token, name, _countof(name)))
+			{
+				size_t nameLength = wcslen(name) + 1;
+				functionInfo->Name = new wchar_t[nameLength];
+				wcscpy_s(functionInfo->Name, nameLength, name);
+				functionInfo->ID = functionId;
+			}
+		}
+
+		if (functionInfo->ID != static_cast<FunctionID>(-1))
+		{
+			EventWriteFunctionIDDefinitionEvent(functionInfo->ID, functionInfo->Token, functionInfo->Class, moduleId, functionInfo->Name);
+		}
+		else
+		{
+			LOG_TRACE(L"Error getting information for function ID 0x%x\n", functionId);
+			return NULL;
+		}
+	}
+	return functionInfo;
+}
+
+//==============================================================================
+// Makes sure we have logged the FunctionIDDefinition events for 'functionIds' (0 is skipped).  
+void CorProfilerTracer::DefineFunctions(const ULONGLONG* functionIds, size_t count)
+{
+	EnterCriticalSection(&m_lock);
+	for (size_t i = 0; i < count; i++)
+	{
+		if (functionIds[i] != 0)
+			(void)GetFunctionInfo((FunctionID)functionIds[i]);
+	}
+	LeaveCriticalSection(&m_lock);
+}
+
+//==============================================================================
+// Called by the function ID mapper (when the method is first JIT compiled) to decide whether to hook 'functionId'.
+// If its Type.Method name matches the PerfView_MethodLatency patterns, we give it a latency histogram, and if it matches 
+// the PerfView_CallScopeAnchors patterns it is a CallScoped anchor.  Without PerfView_MethodLatency, everything is hooked.  
+bool CorProfilerTracer::SelectHookedFunction(FunctionID functionId, bool* isAnchor)
+{
+	bool hook = !m_methodLatencyHooks;
+	EnterCriticalSection(&m_lock);
+	FunctionInfo* functionInfo = GetFunctionInfo(functionId);
+	if (functionInfo != NULL)
+	{
+		const wchar_t* name = functionInfo->Name;
+		if (m_callScopeHooks && m_callScopeAnchorCount < CallScopeMaxAnchors && MatchesPatterns(m_callScopeAnchors, name))
+		{
+			ULONG idx = CallScopeAnchorSlot(functionId);
+			while (CallScopeAnchors[idx] != 0)
+				idx = (idx + 1) & (_countof(CallScopeAnchors) - 1);
+			CallScopeAnchors[idx] = functionId;
+			m_callScopeAnchorCount++;
+			*isAnchor = true;
+			hook = true;
+		}
+		if (m_methodLatencyHooks && m_methodLatencies.size() < MethodLatencyMaxMethods && MatchesPatterns(m_methodLatencyPatterns, name))
+		{
+			MethodLatencyHistogram* histogram = new MethodLatencyHistogram(functionId, name);
+			m_methodLatencies.push_back(histogram);
+			ULONG idx = MethodLatencySlot(functionId);
+			while (MethodLatencyTable[idx] != NULL)
+				idx = (idx + 1) & (_countof(MethodLatencyTable) - 1);
+			InterlockedExchangePointer((PVOID volatile*)&MethodLatencyTable[idx], histogram);
+			hook = true;
+		}
+	}
+	LeaveCriticalSection(&m_lock);
+	return hook;
+}
+
+//==============================================================================
+// Logs a MethodLatency event with the latency histogram (so far) of each of the methods PerfView_MethodLatency selected.  
+void CorProfilerTracer::LogMethodLatency()
+{
+	ULONGLONG ticksPerSecond = TscTicksPerSecond();
+	unsigned short bucketIndexes[LatencyBucketCount];
+	ULONGLONG bucketCounts[LatencyBucketCount];
+
+	EnterCriticalSection(&m_lock);
+	for (auto it = m_methodLatencies.begin(); it != m_methodLatencies.end(); ++it)
+	{
+		MethodLatencyHistogram* histogram = *it;
+		ULONG bucketCount = histogram->GetBuckets(bucketIndexes, bucketCounts);
+		EventWriteMethodLatencyEvent(histogram->ID, ticksPerSecond, LatencySubBucketBits, histogram->Count, histogram->SumTicks,
+			histogram->MaxTicks, bucketCount, bucketIndexes, bucketCounts, histogram->Name);
+	}
+	LeaveCriticalSection(&m_lock);
+}
+
+//==============================================================================
+// When an exception unwinds a method it does not return, so the leave hook does not tell us it is gone.  
+// We remember which method is being unwound here and pop it in ExceptionUnwindFunctionLeave (after its finallys ran).  
+static __declspec(thread) FunctionID UnwindingFunction = 0;
+
+// For Exceptions, each thread remembers the type of the exception it is dispatching, which phase of the dispatch it 
+// is in (searching for the handler, then unwinding to it), and when that phase started.  
+enum ExceptionPhase { ExceptionNone, ExceptionSearch, ExceptionUnwind };
+static __declspec(thread) ClassID ExceptionClass = 0;
+static __declspec(thread) BYTE ExceptionDispatchPhase = ExceptionNone;
+static __declspec(thread) ULONGLONG ExceptionPhaseStartTicks = 0;
+
+HRESULT CorProfilerTracer::ExceptionUnwindFunctionEnter(FunctionID functionId)
+{
+	UnwindingFunction = functionId;
+	if (ExceptionDispatchPhase == ExceptionSearch)
+		EndExceptionPhase(ExceptionUnwind);
+	return S_OK;
+}
+
+HRESULT CorProfilerTracer::ExceptionUnwindFunctionLeave()
+{
+	if (UnwindingFunction != 0)
+	{
+		LeaveMethod(IsCallScopeAnchor(UnwindingFunction) ? (UnwindingFunction | CallScopeAnchorTag) : UnwindingFunction);
+		UnwindingFunction = 0;
+	}
+	return S_OK;
+}
+
+HRESULT CorProfilerTracer::ExceptionCatcherEnter(FunctionID functionId, ObjectID objectId)
+{
+	UNREFERENCED_PARAMETER(functionId);
+	UNREFERENCED_PARAMETER(objectId);
+	if (ExceptionDispatchPhase != ExceptionNone)
+		EndExceptionPhase(ExceptionNone);
+	return S_OK;
+}
+
+// Charges the time since the current phase of the exception this thread is dispatching started to the exception's type, 
+// and moves on to 'nextPhase'.  
+void CorProfilerTracer::EndExceptionPhase(BYTE nextPhase)
+{
+	ULONGLONG now = __rdtsc();
+	ULONGLONG ticks = now - ExceptionPhaseStartTicks;
+	EnterCriticalSection(&m_lock);
+	ClassInfo* classInfo = GetClassInfo(ExceptionClass);
+	if (classInfo != NULL)
+	{
+		if (ExceptionDispatchPhase == ExceptionSearch)
+			classInfo->ExceptionSearchTicks += ticks;
+		else
+			classInfo->ExceptionUnwindTicks += ticks;
+	}
+	LeaveCriticalSection(&m_lock);
+	ExceptionDispatchPhase = nextPhase;
+	ExceptionPhaseStartTicks = now;
 }
 
 //==============================================================================
-CorProfilerTracer :: ~CorProfilerTracer()
+// For JitLatency.  JIT compilations can nest on a thread (e.g. the IL stubs the method being compiled needs), so 
+// each thread has a small stack of the methods it is compiling and when it started.  JitLatencyGeneration changes 
+// each time JitLatency is turned on, to forget the compilations that finished while it was off.  
+static __declspec(thread) LatencyFrame JitStack[JitMaxDepth];
+static __declspec(thread) int JitDepth = 0;			// Can be more than JitMaxDepth (those compilations are not timed)
+static __declspec(thread) LONG JitStackGeneration = 0;
+
+HRESULT CorProfilerTracer::JITCompilationStarted(FunctionID functionId, BOOL fIsSafeToBlock)
 {
-	if (m_info != NULL)
-		m_info->Release();
+	UNREFERENCED_PARAMETER(fIsSafeToBlock);
+	StartupActivityStart(StartupJit, functionId);
+	if ((m_currentKeywords & JitLatencyKeyword) != 0)
+	{
+		if (JitStackGeneration != JitLatencyGeneration)
+		{
+			JitDepth = 0;
+			JitStackGeneration = JitLatencyGeneration;
+		}
+		if (JitDepth < JitMaxDepth)
+		{
+			JitStack[JitDepth].ID = functionId;
+			JitStack[JitDepth].EnterTicks = __rdtsc();
+		}
+		JitDepth++;
+	}
+	return S_OK;
+}
 
-	DeleteCriticalSection(&m_lock);
-	LOG_TRACE(L"Destroying CorProfilerInstance\n");
-	CLOSE_LOG(TRACE_LOGGER);
+//==============================================================================
+// For PerfMap, adds the method's code to the perf map.  For JitLatency, adds the time the compilation took to the 
+// histogram of all compilations, and to its method's and module's totals.  
+// JIT compiling takes far longer than taking m_lock, so we keep the totals in the FunctionInfo and ModuleInfo.  
+HRESULT CorProfilerTracer::JITCompilationFinished(FunctionID functionId, HRESULT hrStatus, BOOL fIsSafeToBlock)
+{
+	UNREFERENCED_PARAMETER(fIsSafeToBlock);
+	StartupActivityStop(StartupJit, functionId, SUCCEEDED(hrStatus));
+	if ((m_currentKeywords & PerfMapKeyword) != 0 && SUCCEEDED(hrStatus))
+		AddToPerfMap(functionId);
+
+	if ((m_currentKeywords & JitLatencyKeyword) != 0 && JitDepth > 0 && JitStackGeneration == JitLatencyGeneration)
+	{
+		ULONGLONG now = __rdtsc();
+		if (JitDepth > JitMaxDepth)
+		{
+			JitDepth--;			// A compilation we did not time
+			return S_OK;
+		}
+
+		// Normally the method is on the top of the stack, but if we missed a finish, pop the ones above it too.  
+		int depth = JitDepth;
+		while (depth > 0 && JitStack[depth - 1].ID != functionId)
+			--depth;
+		if (depth > 0)
+		{
+			ULONGLONG ticks = now - JitStack[depth - 1].EnterTicks;
+			JitDepth = depth - 1;
+			m_jitHistogram->Add(ticks);
+
+			EnterCriticalSection(&m_lock);
+			FunctionInfo* functionInfo = GetFunctionInfo(functionId);
+			if (functionInfo != NULL)
+			{
+				functionInfo->JitCount++;
+				functionInfo->JitTicks += ticks;
+				if (functionInfo->ModuleInfo != NULL)
+				{
+					functionInfo->ModuleInfo->JitCount++;
+					functionInfo->ModuleInfo->JitTicks += ticks;
+				}
+			}
+			LeaveCriticalSection(&m_lock);
+		}
+	}
+	return S_OK;
 }
 
 //==============================================================================
-HRESULT CorProfilerTracer::QueryInterface(
-	REFIID  riid,
-	void ** ppInterface)
+// For JitInlining, each thread that JIT compiles counts the (caller, callee) pairs it inlined in its own table.  
+// We only observe the decision (we never change *pfShouldInline).  The JIT only asks us about the methods it 
+// decided to inline, so the call sites it did not inline are not counted.  
+static __declspec(thread) CallCountTable* JitInlines = NULL;
+
+HRESULT CorProfilerTracer::JITInlining(FunctionID callerId, FunctionID calleeId, BOOL* pfShouldInline)
 {
-	if (riid == IID_IUnknown)
-		*ppInterface = static_cast<ICorProfilerCallback*>(this);
-	else if (riid == IID_ICorProfilerCallback)
-		*ppInterface = static_cast<ICorProfilerCallback*>(this);
-	else if (riid == IID_ICorProfilerCallback2)
-		*ppInterface = static_cast<ICorProfilerCallback2*>(this);
-	else if (riid == IID_ICorProfilerCallback3)
-		*ppInterface = static_cast<ICorProfilerCallback3*>(this);
-	// TODO FIX NOW add support or ICorProfilerCallback4 (for large objects)
-	else
+	UNREFERENCED_PARAMETER(pfShouldInline);
+	if ((m_currentKeywords & JitInliningKeyword) != 0)
 	{
-		*ppInterface = NULL;
-		return E_NOTIMPL;
+		if (JitInlines == NULL)
+		{
+			JitInlines = new CallCountTable();
+			EnterCriticalSection(&m_callCountLock);
+			m_jitInlineTables.push_back(JitInlines);
+			LeaveCriticalSection(&m_callCountLock);
+		}
+		JitInlines->Increment(calleeId, callerId);
 	}
-	reinterpret_cast<IUnknown *>(*ppInterface)->AddRef();
 	return S_OK;
 }
 
 //==============================================================================
-HRESULT CorProfilerTracer::Shutdown()
+// Logs JitInlineCounts events with the number of times (over all threads) each method was inlined so far, and 
+// into how many different methods.  
+void CorProfilerTracer::LogJitInlines()
 {
-	LOG_TRACE(L"Shutdown \n");
-	EventWriteProfilerShutdown();
-	EventUnregisterETWClrProfiler();
-	ClearTables();
+	EnterCriticalSection(&m_callCountLock);
+	std::map<std::pair<FunctionID, FunctionID>, ULONGLONG> inlines;
+	for (auto it = m_jitInlineTables.begin(); it != m_jitInlineTables.end(); ++it)
+		(*it)->AddEdgesTo(inlines);
+	LeaveCriticalSection(&m_callCountLock);
 
-	if (m_info != NULL)
-		m_info->Release();
-	m_info = NULL;
+	std::unordered_map<FunctionID, std::pair<ULONGLONG, ULONG>> callees;		// Inline count and caller count
+	for (auto it = inlines.begin(); it != inlines.end(); ++it)
+	{
+		std::pair<ULONGLONG, ULONG>& callee = callees[it->first.second];
+		callee.first += it->second;
+		callee.second++;
+	}
+
+	std::vector<ULONGLONG> functionIds;
+	std::vector<ULONGLONG> inlineCounts;
+	std::vector<ULONG> callerCounts;
+	functionIds.reserve(callees.size());
+	inlineCounts.reserve(callees.size());
+	callerCounts.reserve(callees.size());
+	for (auto it = callees.begin(); it != callees.end(); ++it)
+	{
+		functionIds.push_back(it->first);
+		inlineCounts.push_back(it->second.first);
+		callerCounts.push_back(it->second.second);
+	}
+	DefineFunctions(functionIds.data(), functionIds.size());
+
+	const int maxCount = MaxEventPayload / (2 * sizeof(ULONGLONG) + sizeof(ULONG));
+	ULONG calleeCount = (ULONG)functionIds.size();
+	for (ULONG idx = 0; idx < calleeCount; idx += maxCount)
+		EventWriteJitInlineCountsEvent(min(calleeCount - idx, maxCount), &functionIds[idx], &inlineCounts[idx], &callerCounts[idx]);
+}
+
+//==============================================================================
+// For Transitions, each thread counts its transitions between managed and native code by method and kind in its own 
+// table.  A P/Invoke's native time is the time from its call transition to its return transition, which we match up 
+// with a small stack per thread (a call from native code can make another P/Invoke before the first one returns).  
+// TransitionGeneration changes each time Transitions is turned on, to forget the P/Invokes that returned while it was off.  
+enum TransitionKind { TransitionPInvoke, TransitionPInvokeReturn, TransitionReversePInvoke, TransitionReversePInvokeReturn, TransitionNativeTicks };
+static __declspec(thread) CallCountTable* Transitions = NULL;
+static __declspec(thread) LatencyFrame TransitionStack[TransitionMaxDepth];
+static __declspec(thread) int TransitionDepth = 0;			// Can be more than TransitionMaxDepth (those P/Invokes are not timed)
+static __declspec(thread) LONG TransitionStackGeneration = 0;
+
+CallCountTable* CorProfilerTracer::GetTransitionTable()
+{
+	if (Transitions == NULL)
+	{
+		Transitions = new CallCountTable();
+		EnterCriticalSection(&m_callCountLock);
+		m_transitionTables.push_back(Transitions);
+		LeaveCriticalSection(&m_callCountLock);
+	}
+	return Transitions;
+}
+
+HRESULT CorProfilerTracer::ManagedToUnmanagedTransition(FunctionID functionId, COR_PRF_TRANSITION_REASON reason)
+{
+	if ((m_currentKeywords & TransitionsKeyword) == 0 || functionId == 0)
+		return S_OK;
+	CallCountTable* table = GetTransitionTable();
+	if (reason == COR_PRF_TRANSITION_CALL)
+	{
+		table->Increment(functionId, TransitionPInvoke);
+		if (TransitionStackGeneration != TransitionGeneration)
+		{
+			TransitionDepth = 0;
+			TransitionStackGeneration = TransitionGeneration;
+		}
+		if (TransitionDepth < TransitionMaxDepth)
+		{
+			TransitionStack[TransitionDepth].ID = functionId;
+			TransitionStack[TransitionDepth].EnterTicks = __rdtsc();
+		}
+		TransitionDepth++;
+	}
+	else
+		table->Increment(functionId, TransitionReversePInvokeReturn);
+	return S_OK;
+}
 
+HRESULT CorProfilerTracer::UnmanagedToManagedTransition(FunctionID functionId, COR_PRF_TRANSITION_REASON reason)
+{
+	if ((m_currentKeywords & TransitionsKeyword) == 0 || functionId == 0)
+		return S_OK;
+	CallCountTable* table = GetTransitionTable();
+	if (reason == COR_PRF_TRANSITION_RETURN)
+	{
+		table->Increment(functionId, TransitionPInvokeReturn);
+		if (TransitionDepth > 0 && TransitionStackGeneration == TransitionGeneration)
+		{
+			ULONGLONG now = __rdtsc();
+			if (TransitionDepth > TransitionMaxDepth)
+				TransitionDepth--;			// A P/Invoke we did not time
+			else
+			{
+				// Normally the P/Invoke is on the top of the stack, but if an exception left one without a return 
+				// transition, pop the ones above it too.  
+				int depth = TransitionDepth;
+				while (depth > 0 && TransitionStack[depth - 1].ID != functionId)
+					--depth;
+				if (depth > 0)
+				{
+					table->Increment(functionId, TransitionNativeTicks, now - TransitionStack[depth - 1].EnterTicks);
+					TransitionDepth = depth - 1;
+				}
+			}
+		}
+	}
+	else
+		table->Increment(functionId, TransitionReversePInvoke);
 	return S_OK;
 }
 
 //==============================================================================
-// Sends out the accumulated class (and module) information events.  This is for
-// rundown.  
-void CorProfilerTracer::DumpClassInfo()
+// Logs TransitionCounts events with the number of transitions (over all threads) through each method of each kind 
+// so far, along with the native time of the P/Invokes.  
+void CorProfilerTracer::LogTransitions()
 {
-	for (auto moduleIter = m_moduleInfo.begin(); moduleIter != m_moduleInfo.end(); moduleIter++)
+	EnterCriticalSection(&m_callCountLock);
+	std::map<std::pair<FunctionID, FunctionID>, ULONGLONG> totals;		// Indexed by (kind, method)
+	for (auto it = m_transitionTables.begin(); it != m_transitionTables.end(); ++it)
+		(*it)->AddEdgesTo(totals);
+	LeaveCriticalSection(&m_callCountLock);
+
+	std::vector<ULONGLONG> functionIds;
+	std::vector<BYTE> kinds;
+	std::vector<ULONGLONG> counts;
+	std::vector<ULONGLONG> nativeTicks;
+	for (auto it = totals.begin(); it != totals.end(); ++it)
 	{
-		ModuleInfo* moduleInfo = moduleIter->second;
-		EventWriteModuleIDDefintionEvent(moduleInfo->ID, moduleInfo->AssemblyID, moduleInfo->Path);
+		if (it->first.first == TransitionNativeTicks)
+			continue;
+		ULONGLONG ticks = 0;
+		if (it->first.first == TransitionPInvoke)
+		{
+			auto native = totals.find(std::make_pair((FunctionID)TransitionNativeTicks, it->first.second));
+			if (native != totals.end())
+				ticks = native->second;
+		}
+		functionIds.push_back(it->first.second);
+		kinds.push_back((BYTE)it->first.first);
+		counts.push_back(it->second);
+		nativeTicks.push_back(ticks);
 	}
-	for (auto classIter = m_classInfo.begin(); classIter != m_classInfo.end(); classIter++)
+	DefineFunctions(functionIds.data(), functionIds.size());
+
+	ULONGLONG ticksPerSecond = TscTicksPerSecond();
+	const int maxCount = MaxEventPayload / (3 * sizeof(ULONGLONG) + sizeof(BYTE));
+	ULONG transitionCount = (ULONG)functionIds.size();
+	for (ULONG idx = 0; idx < transitionCount; idx += maxCount)
 	{
-		ClassInfo* classInfo = classIter->second;
-		EventWriteClassIDDefintionEvent(classInfo->ID, classInfo->Token, classInfo->Flags, classInfo->ModuleInfo->ID, classInfo->Name);
+		EventWriteTransitionCountsEvent(ticksPerSecond, min(transitionCount - idx, maxCount), &functionIds[idx], &kinds[idx], 
+			&counts[idx], &nativeTicks[idx]);
 	}
 }
 
 //==============================================================================
-// Clears out all remembered information from our tables.  
-void CorProfilerTracer::ClearTables()
+// Starts writing the perf map (perf-<pid>.map in PerfView_PerfMapDirectory, or else the temp directory) with the 
+// methods that were JIT compiled before PerfMap was turned on.  JITCompilationFinished adds the ones compiled after that.  
+void CorProfilerTracer::StartPerfMap()
 {
-	for (auto classIter = m_classInfo.begin(); classIter != m_classInfo.end(); classIter++)
-		delete classIter->second;
-	m_classInfo.clear();
+	if (m_perfMap->IsStarted())
+		return;
 
-	for (auto moduleIter = m_moduleInfo.begin(); moduleIter != m_moduleInfo.end(); moduleIter++)
-		delete moduleIter->second;
-	m_moduleInfo.clear();
+	wchar_t directory[MAX_PATH];
+	if (!GetPerfViewStringSetting(L"PerfView_PerfMapDirectory", directory, _countof(directory)) && GetTempPathW(_countof(directory), directory) == 0)
+		return;
+	size_t directoryLength = wcslen(directory);
+	const wchar_t* separator = (directoryLength > 0 && directory[directoryLength - 1] == L'\\') ? L"" : L"\\";
+	wchar_t path[MAX_PATH];
+	if (_snwprintf_s(path, _countof(path), _TRUNCATE, L"%s%sperf-%u.map", directory, separator, GetCurrentProcessId()) < 0)
+	{
+		EventWriteProfilerError(HRESULT_FROM_WIN32(ERROR_FILENAME_EXCED_RANGE), L"The perf map path is too long");
+		return;
+	}
+	HRESULT hr = m_perfMap->Start(path);
+	if (FAILED(hr))
+	{
+		EventWriteProfilerError(hr, L"Could not create the perf map");
+		return;
+	}
+
+	ULONG methodCount = 0;
+	ICorProfilerFunctionEnum* functionEnum = NULL;
+	if (m_info->EnumJITedFunctions(&functionEnum) == S_OK)
+	{
+		COR_PRF_FUNCTION functions[64];
+		ULONG fetched = 0;
+		while (SUCCEEDED(functionEnum->Next(_countof(functions), functions, &fetched)) && fetched > 0)
+		{
+			for (ULONG i = 0; i < fetched; i++)
+				AddToPerfMap(functions[i].functionId);
+			methodCount += fetched;
+		}
+		functionEnum->Release();
+	}
+	EventWritePerfMapEvent(path, methodCount);
 }
 
 //==============================================================================
-DWORD WINAPI CorProfilerTracer::ForceGCBody(LPVOID lpParameter)
+// Adds the code of 'functionId' (its name comes from the FunctionInfo, and thus the module's metadata) to the perf map.  
+void CorProfilerTracer::AddToPerfMap(FunctionID functionId)
 {
-	LOG_TRACE(L"ForceGCBody");
-	CorProfilerTracer* profiler = (CorProfilerTracer*)lpParameter;
-	HRESULT hr = profiler->m_info->ForceGC();
-	LOG_TRACE(L"ForceGC Call returns 0x%x\n", hr);
-	if (hr != S_OK)
-		EventWriteProfilerError(hr, L"Profiler ForceGC Failed");
-	profiler->m_forcingGC = false;
-	return hr;
+	wchar_t name[MethodNameMaxChars];
+	EnterCriticalSection(&m_lock);
+	FunctionInfo* functionInfo = GetFunctionInfo(functionId);
+	if (functionInfo != NULL && functionInfo->Name != NULL)
+		wcscpy_s(name, _countof(name), functionInfo->Name);
+	else
+		swprintf_s(name, _countof(name), L"Function_%llx", (ULONGLONG)functionId);
+	LeaveCriticalSection(&m_lock);
+
+	COR_PRF_CODE_INFO codeInfos[8];
+	ULONG32 codeInfoCount = 0;
+	if (m_info->GetCodeInfo2(functionId, _countof(codeInfos), &codeInfoCount, codeInfos) != S_OK)
+		return;
+	codeInfoCount = min(codeInfoCount, (ULONG32)_countof(codeInfos));
+	for (ULONG32 i = 0; i < codeInfoCount; i++)
+		m_perfMap->Add(codeInfos[i].startAddress, codeInfos[i].size, name);
+}
+
+//==============================================================================
+// Logs the JitLatency events: the JitTopN methods that took longest to compile so far (JitMethodTimes), every 
+// module's totals (JitModuleTimes) and the histogram of all the compilations (JitTimeHistogram).  
+void CorProfilerTracer::LogJitTimes()
+{
+	ULONGLONG ticksPerSecond = TscTicksPerSecond();
+	std::vector<ULONGLONG> functionIds;
+	std::vector<ULONG> functionJitCounts;
+	std::vector<ULONGLONG> functionJitTicks;
+	std::vector<ULONGLONG> moduleIds;
+	std::vector<ULONG> moduleJitCounts;
+	std::vector<ULONGLONG> moduleJitTicks;
+
+	EnterCriticalSection(&m_lock);
+	std::vector<FunctionInfo*> compiled;
+	for (auto it = m_functionInfo.begin(); it != m_functionInfo.end(); ++it)
+	{
+		if (it->second->JitCount != 0)
+			compiled.push_back(it->second);
+	}
+	size_t topCount = min(compiled.size(), (size_t)JitTopN);
+	std::partial_sort(compiled.begin(), compiled.begin() + topCount, compiled.end(),
+		[](const FunctionInfo* a, const FunctionInfo* b) { return a->JitTicks > b->JitTicks; });
+	for (size_t i = 0; i < topCount; i++)
+	{
+		functionIds.push_back(compiled[i]->ID);
+		functionJitCounts.push_back(compiled[i]->JitCount);
+		functionJitTicks.push_back(compiled[i]->JitTicks);
+	}
+	for (auto it = m_moduleInfo.begin(); it != m_moduleInfo.end(); ++it)
+	{
+		if (it->second->JitCount != 0)
+		{
+			moduleIds.push_back(it->second->ID);
+			moduleJitCounts.push_back(it->second->JitCount);
+			moduleJitTicks.push_back(it->second->JitTicks);
+		}
+	}
+	LeaveCriticalSection(&m_lock);
+
+	EventWriteJitMethodTimesEvent(ticksPerSecond, (ULONG)functionIds.size(), functionIds.data(), functionJitCounts.data(), functionJitTicks.data());
+
+	const int maxCount = MaxEventPayload / (2 * sizeof(ULONGLONG) + sizeof(ULONG));
+	ULONG moduleCount = (ULONG)moduleIds.size();
+	for (ULONG idx = 0; idx < moduleCount; idx += maxCount)
+		EventWriteJitModuleTimesEvent(ticksPerSecond, min(moduleCount - idx, maxCount), &moduleIds[idx], &moduleJitCounts[idx], &moduleJitTicks[idx]);
+
+	unsigned short bucketIndexes[LatencyBucketCount];
+	ULONGLONG bucketCounts[LatencyBucketCount];
+	ULONG bucketCount = m_jitHistogram->GetBuckets(bucketIndexes, bucketCounts);
+	EventWriteJitTimeHistogramEvent(ticksPerSecond, LatencySubBucketBits, m_jitHistogram->Count, m_jitHistogram->SumTicks,
+		m_jitHistogram->MaxTicks, bucketCount, bucketIndexes, bucketCounts);
+}
+
+//==============================================================================
+// For StartupTimeline, each thread logs what it does for the first m_startupWindowMSec (PerfView_StartupSeconds) 
+// after we started.  The first thread that notices the time is up logs all the threads' logs.  
+static __declspec(thread) StartupThreadLog* StartupLog = NULL;
+
+// Returns this thread's StartupThreadLog, or NULL if StartupTimeline is off or startup is over.  
+StartupThreadLog* CorProfilerTracer::GetStartupLog()
+{
+	if ((m_currentKeywords & StartupTimelineKeyword) == 0 || m_startupLogged != 0)
+		return NULL;
+	if (GetTickCount() - m_startupStartTick >= m_startupWindowMSec)
+	{
+		LogStartupTimeline();
+		return NULL;
+	}
+	if (StartupLog == NULL)
+	{
+		StartupLog = new StartupThreadLog(GetCurrentThreadId());
+		EnterCriticalSection(&m_callCountLock);
+		m_startupLogs.push_back(StartupLog);
+		LeaveCriticalSection(&m_callCountLock);
+	}
+	return StartupLog;
+}
+
+void CorProfilerTracer::StartupActivityStart(BYTE kind, ULONGLONG id)
+{
+	StartupThreadLog* log = GetStartupLog();
+	if (log != NULL)
+		log->Start(kind, id, __rdtsc());
+}
+
+void CorProfilerTracer::StartupActivityStop(BYTE kind, ULONGLONG id, bool succeeded)
+{
+	StartupThreadLog* log = GetStartupLog();
+	if (log != NULL)
+		log->Stop(kind, id, __rdtsc(), succeeded);
+}
+
+//==============================================================================
+HRESULT CorProfilerTracer::AssemblyLoadStarted(AssemblyID assemblyId)
+{
+	StartupActivityStart(StartupAssemblyLoad, assemblyId);
+	return S_OK;
+}
+
+HRESULT CorProfilerTracer::AssemblyLoadFinished(AssemblyID assemblyId, HRESULT hrStatus)
+{
+	StartupActivityStop(StartupAssemblyLoad, assemblyId, SUCCEEDED(hrStatus));
+	return S_OK;
+}
+
+HRESULT CorProfilerTracer::ModuleLoadStarted(ModuleID moduleId)
+{
+	StartupActivityStart(StartupModuleLoad, moduleId);
+	return S_OK;
+}
+
+HRESULT CorProfilerTracer::ModuleLoadFinished(ModuleID moduleId, HRESULT hrStatus)
+{
+	StartupActivityStop(StartupModuleLoad, moduleId, SUCCEEDED(hrStatus));
+	return S_OK;
+}
+
+HRESULT CorProfilerTracer::ClassLoadStarted(ClassID classId)
+{
+	StartupActivityStart(StartupClassLoad, classId);
+	return S_OK;
+}
+
+HRESULT CorProfilerTracer::ClassLoadFinished(ClassID classId, HRESULT hrStatus)
+{
+	StartupActivityStop(StartupClassLoad, classId, SUCCEEDED(hrStatus));
+	return S_OK;
+}
+
+//==============================================================================
+// Logs a StartupTimeline event for each thread (with what it did during startup), and a StartupAssemblyCosts event 
+// with the exclusive time each assembly cost by activity (classes and methods are charged to their module's assembly).  
+// This happens once, when startup is over (or at capture state if that is sooner).  
+void CorProfilerTracer::LogStartupTimeline()
+{
+	if (InterlockedExchange(&m_startupLogged, 1) != 0)
+		return;
+
+	ULONGLONG ticksPerSecond = TscTicksPerSecond();
+	EnterCriticalSection(&m_callCountLock);
+	std::vector<StartupThreadLog*> logs(m_startupLogs);
+	LeaveCriticalSection(&m_callCountLock);
+
+	struct AssemblyCosts
+	{
+		ULONGLONG Ticks[StartupActivityCount];
+		ULONG ClassLoads;
+		ULONG Jits;
+	};
+	std::unordered_map<AssemblyID, AssemblyCosts> costs;
+	std::vector<StartupThreadLog::Interval> intervals;
+	std::vector<BYTE> kinds;
+	std::vector<ULONGLONG> ids;
+	std::vector<ULONGLONG> startTicks;
+	std::vector<ULONGLONG> durationTicks;
+	const int maxCount = MaxEventPayload / (sizeof(BYTE) + 3 * sizeof(ULONGLONG));
+	for (auto logIter = logs.begin(); logIter != logs.end(); ++logIter)
+	{
+		(*logIter)->CopyIntervals(intervals);
+		kinds.clear();
+		ids.clear();
+		startTicks.clear();
+		durationTicks.clear();
+
+		// Getting the infos logs the definitions of the IDs too.  
+		EnterCriticalSection(&m_lock);
+		for (auto it = intervals.begin(); it != intervals.end(); ++it)
+		{
+			kinds.push_back(it->Kind);
+			ids.push_back(it->ID);
+			startTicks.push_back(it->StartTicks - m_tscStartTsc);
+			durationTicks.push_back(it->StopTicks - it->StartTicks);
+
+			AssemblyID assemblyId = 0;
+			ModuleInfo* moduleInfo = NULL;
+			if (it->Kind == StartupAssemblyLoad)
+				assemblyId = (AssemblyID)it->ID;
+			else if (it->Kind == StartupModuleLoad)
+				moduleInfo = GetModuleInfo((ModuleID)it->ID);
+			else if (it->Kind == StartupClassLoad)
+			{
+				ClassInfo* classInfo = GetClassInfo((ClassID)it->ID);
+				if (classInfo != NULL)
+					moduleInfo = classInfo->ModuleInfo;
+			}
+			else
+			{
+				FunctionInfo* functionInfo = GetFunctionInfo((FunctionID)it->ID);
+				if (functionInfo != NULL)
+					moduleInfo = functionInfo->ModuleInfo;
+			}
+			if (moduleInfo != NULL)
+				assemblyId = moduleInfo->AssemblyID;
+
+			AssemblyCosts& cost = costs[assemblyId];
+			cost.Ticks[it->Kind] += it->ExclusiveTicks;
+			if (it->Kind == StartupClassLoad)
+				cost.ClassLoads++;
+			else if (it->Kind == StartupJit)
+				cost.Jits++;
+		}
+		LeaveCriticalSection(&m_lock);
+
+		ULONG intervalCount = (ULONG)kinds.size();
+		for (ULONG idx = 0; idx < intervalCount; idx += maxCount)
+		{
+			EventWriteStartupTimelineEvent((*logIter)->ThreadID, ticksPerSecond, min(intervalCount - idx, maxCount), 
+				&kinds[idx], &ids[idx], &startTicks[idx], &durationTicks[idx]);
+		}
+	}
+
+	std::vector<ULONGLONG> assemblyIds;
+	std::vector<ULONGLONG> activityTicks[StartupActivityCount];
+	std::vector<ULONG> classLoadCounts;
+	std::vector<ULONG> jitCounts;
+	for (auto it = costs.begin(); it != costs.end(); ++it)
+	{
+		assemblyIds.push_back(it->first);
+		for (int kind = 0; kind < StartupActivityCount; kind++)
+			activityTicks[kind].push_back(it->second.Ticks[kind]);
+		classLoadCounts.push_back(it->second.ClassLoads);
+		jitCounts.push_back(it->second.Jits);
+	}
+	const int maxAssemblies = MaxEventPayload / (5 * sizeof(ULONGLONG) + 2 * sizeof(ULONG));
+	ULONG assemblyCount = (ULONG)assemblyIds.size();
+	for (ULONG idx = 0; idx < assemblyCount; idx += maxAssemblies)
+	{
+		EventWriteStartupAssemblyCostsEvent(ticksPerSecond, min(assemblyCount - idx, maxAssemblies), &assemblyIds[idx], 
+			&activityTicks[StartupAssemblyLoad][idx], &activityTicks[StartupModuleLoad][idx], &activityTicks[StartupClassLoad][idx], 
+			&activityTicks[StartupJit][idx], &classLoadCounts[idx], &jitCounts[idx]);
+	}
+}
+
+//==============================================================================
+// We remember every managed thread (and its OS thread) so that CpuSamples can sample them.  
+HRESULT CorProfilerTracer::ThreadCreated(ThreadID threadId)
+{
+	SampledThread thread = { 0, NULL, 0 };
+	EnterCriticalSection(&m_threadLock);
+	m_threads.insert(std::make_pair(threadId, thread));
+	LeaveCriticalSection(&m_threadLock);
+	return S_OK;
+}
+
+//==============================================================================
+// Forgets the thread, and adds its call counts and call tree to the ones of the threads that died and frees them, 
+// so that we do not keep a table for every thread there ever was.  The thread runs no more managed code, so 
+// nothing uses them again.  
+HRESULT CorProfilerTracer::ThreadDestroyed(ThreadID threadId)
+{
+	EnterCriticalSection(&m_callCountLock);
+	auto counts = m_callCountTables.find(threadId);
+	if (counts != m_callCountTables.end())
+	{
+		if (counts->second->Generation == CallCountGeneration)
+			counts->second->AddTo(m_deadThreadCallCounts);
+		delete counts->second;
+		m_callCountTables.erase(counts);
+	}
+	auto tree = m_callTrees.find(threadId);
+	if (tree != m_callTrees.end())
+	{
+		m_deadThreadCallTree->AddTree(*tree->second);
+		delete tree->second;
+		m_callTrees.erase(tree);
+	}
+	LeaveCriticalSection(&m_callCountLock);
+
+	EnterCriticalSection(&m_threadLock);
+	auto it = m_threads.find(threadId);
+	if (it != m_threads.end())
+	{
+		if (it->second.Handle != NULL)
+			CloseHandle(it->second.Handle);
+		m_threads.erase(it);
+	}
+	LeaveCriticalSection(&m_threadLock);
+	return S_OK;
 }
 
 //==============================================================================
-// We do the GC on another thread to avoid 'poluting' the ETW callback thread. 
-void CorProfilerTracer::ForceGC()
+// A managed thread can (in theory) move between OS threads, so we open the handle we suspend it with here.  
+HRESULT CorProfilerTracer::ThreadAssignedToOSThread(ThreadID managedThreadId, DWORD osThreadId)
 {
-	m_forcingGC = true;
-	HANDLE thread = CreateThread(0, 0, ForceGCBody, this, 0, NULL);
-	LOG_TRACE(L"ForceGC: thread 0x%x\n", thread);
-	UNREFERENCED_PARAMETER(thread);
-	for (int i = 0; i < 2000; i++)
-	{
-		if (!m_forcingGC)
-			break;
-		Sleep(10);
-	}
+	HANDLE handle = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_LIMITED_INFORMATION, FALSE, osThreadId);
+	EnterCriticalSection(&m_threadLock);
+	SampledThread& thread = m_threads[managedThreadId];
+	if (thread.Handle != NULL)
+		CloseHandle(thread.Handle);
+	thread.OSThreadID = osThreadId;
+	thread.Handle = handle;
+	thread.Cycles = 0;
+	LeaveCriticalSection(&m_threadLock);
+	return S_OK;
 }
 
-STDMETHODIMP CorProfilerTracer::ModuleAttachedToAssembly(ModuleID moduleId, AssemblyID assemblyId)
+//==============================================================================
+// When we attach, the threads that already exist were created before we asked for the thread callbacks, so 
+// we enumerate them here (EnumThreads needs ICorProfilerInfo4, which .NET 4.5 has).  The callbacks are already on, 
+// so we skip the threads they have told us about.  
+HRESULT CorProfilerTracer::ProfilerAttachComplete()
 {
-	auto moduleInfo = GetModuleInfo(moduleId);
-	if (moduleInfo && moduleInfo->AssemblyID != assemblyId)
+	ICorProfilerInfo4* info4 = NULL;
+	if (FAILED(m_info->QueryInterface(__uuidof(ICorProfilerInfo4), (void**)&info4)))
+		return S_OK;
+	ICorProfilerThreadEnum* threadEnum = NULL;
+	if (SUCCEEDED(info4->EnumThreads(&threadEnum)))
 	{
-		if (!moduleInfo->Path)
+		ThreadID threadIds[64];
+		ULONG fetched = 0;
+		while (SUCCEEDED(threadEnum->Next(_countof(threadIds), threadIds, &fetched)) && fetched > 0)
 		{
-			ULONG pathLength;
-			AppDomainID appDomainId;
-			ModuleID manifestModuleId;
-			m_info->GetAssemblyInfo(assemblyId, 0, &pathLength, nullptr, &appDomainId, &manifestModuleId);
-			if (pathLength > 0)
+			for (ULONG i = 0; i < fetched; i++)
 			{
-				moduleInfo->Path = new wchar_t[pathLength];
-				m_info->GetAssemblyInfo(assemblyId, pathLength, &pathLength, moduleInfo->Path, &appDomainId, &manifestModuleId);
-			}
-
-			if (!moduleInfo->Path)
-			{
-				moduleInfo->Path = new wchar_t[1];
-				moduleInfo->Path[0] = L'\0';
+				EnterCriticalSection(&m_threadLock);
+				bool known = m_threads.find(threadIds[i]) != m_threads.end();
+				LeaveCriticalSection(&m_threadLock);
+				DWORD osThreadId = 0;
+				if (!known && SUCCEEDED(m_info->GetThreadInfo(threadIds[i], &osThreadId)) && osThreadId != 0)
+					ThreadAssignedToOSThread(threadIds[i], osThreadId);
 			}
 		}
-
-		moduleInfo->AssemblyID = assemblyId;
-		EventWriteModuleIDDefintionEvent(moduleId, assemblyId, moduleInfo->Path);
+		threadEnum->Release();
 	}
-
+	info4->Release();
 	return S_OK;
 }
 
 //==============================================================================
-STDMETHODIMP CorProfilerTracer::ObjectAllocated(ObjectID objectId, ClassID classId)
+// Starts the CpuSamples sampling thread (if it is not already running).  
+void CorProfilerTracer::StartCpuSampling()
 {
-	EnterCriticalSection(&m_lock);
-	// TODO this is probably inefficient, should only call back on classes that are variable sized
-	ULONG size = 0;
-	m_info->GetObjectSize(objectId, &size);
-	ULONG representativeSize = size;
-
-	// We do this for also  the side effect of logging the class  
-	ClassInfo* classInfo = GetClassInfo(classId);
-	if (classInfo == 0)			// TODO FIX NOW, we should log something.  
-		goto Done;
+	if (m_cpuSampleThread != NULL)
+		return;
+	m_cpuSampleStopEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+	if (m_cpuSampleStopEvent != NULL)
+		m_cpuSampleThread = CreateThread(NULL, 0, CpuSampleThreadProc, this, 0, NULL);
+}
 
-	if (m_smartSampling)
+//==============================================================================
+// Stops the CpuSamples sampling thread (which logs the samples it has not logged yet).  
+void CorProfilerTracer::StopCpuSampling()
+{
+	if (m_cpuSampleThread != NULL)
 	{
-		classInfo->AllocsIgnored++;
-		classInfo->IgnoredSize += size;
-
-		// If we are not yet triggering, and the size is below the force keep size, then filter out the sample 
-		if (classInfo->AllocsIgnored < classInfo->SamplingRate && size < classInfo->ForceKeepSize)
-			goto Done;			// Filter out the sample.  
+		SetEvent(m_cpuSampleStopEvent);
+		WaitForSingleObject(m_cpuSampleThread, INFINITE);
+		CloseHandle(m_cpuSampleThread);
+		m_cpuSampleThread = NULL;
+	}
+	if (m_cpuSampleStopEvent != NULL)
+	{
+		CloseHandle(m_cpuSampleStopEvent);
+		m_cpuSampleStopEvent = NULL;
+	}
+}
 
-		// TODO FIX NOW HACK for exchange data collection 
-#ifdef PIN_INVESTIGATION
-#define Near(x,y) (y-0x20 <= x && x <= y + 8)
+//==============================================================================
+// The DoStackSnapshot callback for CpuSamples.  The thread is suspended while this runs, so it must not allocate 
+// or take locks (the thread may hold them), it just remembers the managed frames.  
+struct CpuSampleStack
+{
+	ULONG Count;
+	ULONGLONG Frames[CallStackMaxDepth];
+};
 
-		if (size < classInfo->ForceKeepSize)
-			goto Done;
-		// if (!(Near(size, 0x1e4) || Near(size, 0x4038) || Near(size, 0x403d) || Near(size, 0x1418) || Near(size, 0x2018) || Near(size, 0x53) || Near(size, 0xed8)))
-		   // goto Done;
-#endif 
-		// At this point we will log an event 
+static HRESULT __stdcall CpuSampleFrame(FunctionID functionId, UINT_PTR ip, COR_PRF_FRAME_INFO frameInfo, ULONG32 contextSize, BYTE context[], void* clientData)
+{
+	UNREFERENCED_PARAMETER(ip);
+	UNREFERENCED_PARAMETER(frameInfo);
+	UNREFERENCED_PARAMETER(contextSize);
+	UNREFERENCED_PARAMETER(context);
 
-		// Compute the average allocation rate for this type and from that compute a good sampling rate.  
-		classInfo->AllocCountInCurrentBucket += classInfo->AllocsIgnored;
-		int ticks = GetTickCount();
-		int delta = (ticks - classInfo->TickOfCurrentTimeBucket) & 0x7FFFFFFF;	// make wrap around work.  
+	CpuSampleStack* stack = (CpuSampleStack*)clientData;
+	if (functionId == 0)			// Native frames
+		return S_OK;
+	stack->Frames[stack->Count++] = functionId;
+	return stack->Count < CallStackMaxDepth ? S_OK : S_FALSE;
+}
 
-		int minAllocPerMSec = classInfo->AllocCountInCurrentBucket / 16;		// This is an underestimation of the true rate.  
-		if (delta >= 16 || (minAllocPerMSec > 2 && minAllocPerMSec > classInfo->AllocPerMSec * 1.5F))
+//==============================================================================
+// Returns the ID of the managed stack of 'threadId' (whose OS thread is 'thread'), or 0 if we could not get it.  
+// The thread is suspended while we walk its stack (so it can't be this thread).  If it is running managed code we 
+// seed the walk with its registers, otherwise DoStackSnapshot starts at the last managed frame it called native code from.  
+ULONG CorProfilerTracer::SnapshotStack(ThreadID threadId, const SampledThread& thread)
+{
+	HANDLE handle = thread.Handle;
+	if (handle == NULL || thread.OSThreadID == GetCurrentThreadId() || SuspendThread(handle) == (DWORD)-1)
+		return 0;
+	CONTEXT registers;
+	memset(&registers, 0, sizeof(registers));
+	registers.ContextFlags = CONTEXT_FULL;
+	BYTE* seed = NULL;
+	ULONG32 seedSize = 0;
+	if (GetThreadContext(handle, &registers))
+	{
+#if defined(_M_IX86)
+		UINT_PTR ip = registers.Eip;
+#else
+		UINT_PTR ip = (UINT_PTR)registers.Rip;
+#endif
+		FunctionID topFunction = 0;
+		if (GetFunctionFromIP(ip, &topFunction))
 		{
-			float newAllocPerMSec = 0;
-			if (delta >= 16)
-			{
-				// This is the normal case, our allocation rate is under control with the current throttling.   
-				newAllocPerMSec = ((float)classInfo->AllocCountInCurrentBucket) / delta;
-				// Do a exponential decay window that is 5 * max(16, AllocationInterval)  
-				classInfo->AllocPerMSec = 0.8F *  classInfo->AllocPerMSec + 0.2F * newAllocPerMSec;
-				classInfo->TickOfCurrentTimeBucket = ticks;
-				classInfo->AllocCountInCurrentBucket = 0;
-			}
-			else
-			{
-				newAllocPerMSec = (float)minAllocPerMSec;
-				// This means the second clause above is true, which means our sampling rate is too low
-				// so we need to throttle quickly. 
-				classInfo->AllocPerMSec = (float)minAllocPerMSec;
-			}
-
-			// We want to sample at a rate that ensures less 100 allocations per second per type.  
-			// However don't sample less than 1/1000, 
-			classInfo->SamplingRate = min((int)(classInfo->AllocPerMSec * 10), 1000);
-			if (classInfo->SamplingRate == 1)
-				classInfo->SamplingRate = 0;
+			seed = (BYTE*)&registers;
+			seedSize = sizeof(registers);
 		}
-
-		// We are done calculating the sampling rate since we are logging an event we can reset the 'Ignored' stats and log the event.  
-		representativeSize = classInfo->IgnoredSize;
-		classInfo->AllocsIgnored = 0;
-		classInfo->IgnoredSize = 0;
 	}
-	EventWriteObjectAllocatedEvent(objectId, classId, size, representativeSize);
+	CpuSampleStack stack;
+	stack.Count = 0;
+	HRESULT hr = m_info->DoStackSnapshot(threadId, CpuSampleFrame, COR_PRF_SNAPSHOT_DEFAULT, &stack, seed, seedSize);
+	ResumeThread(handle);
 
-Done:
-	LeaveCriticalSection(&m_lock);
-	return S_OK;
+	if ((SUCCEEDED(hr) || hr == CORPROF_E_STACKSNAPSHOT_ABORTED) && stack.Count > 0)
+		return InternStack(stack.Frames, stack.Count);
+	return 0;
 }
 
 //==============================================================================
-STDMETHODIMP CorProfilerTracer::GarbageCollectionStarted(int cGenerations, BOOL generationCollected[], COR_PRF_GC_REASON reason)
+// Takes one sample of every managed thread that has run since its last sample (its cycle time changed), and adds 
+// one to the count of the stack it was in.  Threads that are blocked are not using the CPU so we skip them.  
+void CorProfilerTracer::SampleThreads(std::unordered_map<ULONG, ULONG>& sampleCounts)
 {
-	LOG_TRACE(L"GC Started\n");
-	int maxGenCollected = 0;
-	for (int i = 0; i < cGenerations; i++)
-		if (generationCollected[i])
-			maxGenCollected = i;
+	EnterCriticalSection(&m_threadLock);
+	for (auto it = m_threads.begin(); it != m_threads.end(); ++it)
+	{
+		SampledThread& thread = it->second;
+		ULONG64 cycles = 0;
+		if (thread.Handle == NULL || !QueryThreadCycleTime(thread.Handle, &cycles) || cycles == thread.Cycles)
+			continue;
+		thread.Cycles = cycles;
 
-	m_gcCount++;
+		ULONG stackId = SnapshotStack(it->first, thread);
+		if (stackId != 0)
+			sampleCounts[stackId]++;
+	}
+	LeaveCriticalSection(&m_threadLock);
+}
 
-#if 0	// TODO FIX NOW implement
-	ULONG boundsCount = 0;
-	COR_PRF_GC_GENERATION_RANGE* bounds = new COR_PRF_GC_GENERATION_RANGE[4];
-	m_info->GetGenerationBounds(4, &boundsCount, bounds);
-	delete bounds;
-#endif
+//==============================================================================
+// Logs a SafePointLaggards event for the suspension that just finished, with the threads that took longest to reach 
+// a safe point and (with PerfView_SafePointStacks, since walking them makes the pause longer) the stacks they 
+// stopped at.  The runtime tells us when it sees each thread suspended, so their 
+// times are when it noticed (which for threads running managed code is when they reached their safe point).  
+void CorProfilerTracer::LogSafePoints()
+{
+	EnterCriticalSection(&m_safePointLock);
+	std::vector<std::pair<ThreadID, ULONGLONG>> threads(m_safePoints);
+	m_safePoints.clear();
+	LeaveCriticalSection(&m_safePointLock);
 
-	EventWriteGCStartEvent(m_gcCount, min(maxGenCollected, 2), reason == COR_PRF_GC_INDUCED);
+	ULONG threadCount = (ULONG)threads.size();
+	ULONG count = min(threadCount, SafePointTopN);
+	std::partial_sort(threads.begin(), threads.begin() + count, threads.end(),
+		[](const std::pair<ThreadID, ULONGLONG>& a, const std::pair<ThreadID, ULONGLONG>& b) { return a.second > b.second; });
 
-	return S_OK;
+	ULONGLONG threadIds[SafePointTopN];
+	ULONG osThreadIds[SafePointTopN];
+	ULONGLONG ticks[SafePointTopN];
+	ULONG stackIds[SafePointTopN];
+	EnterCriticalSection(&m_threadLock);
+	for (ULONG i = 0; i < count; i++)
+	{
+		threadIds[i] = threads[i].first;
+		ticks[i] = threads[i].second - m_suspendStartTicks;
+		osThreadIds[i] = 0;
+		stackIds[i] = 0;
+		auto it = m_threads.find(threads[i].first);
+		if (it != m_threads.end())
+		{
+			osThreadIds[i] = it->second.OSThreadID;
+			if (m_safePointStacks)
+				stackIds[i] = SnapshotStack(it->first, it->second);
+		}
+	}
+	LeaveCriticalSection(&m_threadLock);
+
+	EventWriteSafePointLaggardsEvent(TscTicksPerSecond(), (ULONG)m_suspendReason, m_suspendFinishTicks - m_suspendStartTicks, threadCount, count, 
+		threadIds, osThreadIds, ticks, stackIds);
 }
 
 //==============================================================================
-STDMETHODIMP CorProfilerTracer::GarbageCollectionFinished(void)
+// For Exceptions, counts the throw by the exception's type, samples the stack it was thrown from, and starts timing 
+// the search for its handler.  
+HRESULT CorProfilerTracer::ExceptionThrown(ObjectID thrownObjectId)
 {
-	LOG_TRACE(L"GC End\r\n");
-	EventWriteGCStopEvent(m_gcCount);
+	// An exception thrown while we are dispatching another one (e.g. from a finally) replaces it.  
+	if (ExceptionDispatchPhase != ExceptionNone)
+		EndExceptionPhase(ExceptionNone);
+	if ((m_currentKeywords & ExceptionsKeyword) == 0)
+		return S_OK;
+	ClassID classId = 0;
+	if (FAILED(m_info->GetClassFromObject(thrownObjectId, &classId)))
+		return S_OK;
+
+	bool found = false;
+	bool sampleStack = false;
+	EnterCriticalSection(&m_lock);
+	ClassInfo* classInfo = GetClassInfo(classId);
+	if (classInfo != NULL)
+	{
+		found = true;
+		sampleStack = (classInfo->ThrowCount++ % m_exceptionStackRate) == 0;
+	}
+	LeaveCriticalSection(&m_lock);
+	if (!found)
+		return S_OK;
+
+	if (sampleStack)
+	{
+		CpuSampleStack stack;
+		stack.Count = 0;
+		// A ThreadID of 0 walks this thread's stack, which needs no seed.  
+		HRESULT hr = m_info->DoStackSnapshot(0, CpuSampleFrame, COR_PRF_SNAPSHOT_DEFAULT, &stack, NULL, 0);
+		if ((SUCCEEDED(hr) || hr == CORPROF_E_STACKSNAPSHOT_ABORTED) && stack.Count > 0)
+		{
+			ULONG stackId = InternStack(stack.Frames, stack.Count);
+			EnterCriticalSection(&m_lock);
+			m_exceptionStacks[std::make_pair(classId, stackId)]++;
+			LeaveCriticalSection(&m_lock);
+		}
+	}
+
+	ExceptionClass = classId;
+	ExceptionDispatchPhase = ExceptionSearch;
+	ExceptionPhaseStartTicks = __rdtsc();
 	return S_OK;
 }
 
 //==============================================================================
-STDMETHODIMP CorProfilerTracer::FinalizeableObjectQueued(DWORD finalizerFlags, ObjectID objectID)
+// Logs ExceptionCounts events with the number of throws of each exception type so far and the time their dispatch 
+// took, and ExceptionStacks events with the number of sampled throws from each stack.  
+void CorProfilerTracer::LogExceptions()
 {
-	UNREFERENCED_PARAMETER(finalizerFlags);
+	std::vector<ULONGLONG> classIds;
+	std::vector<ULONG> throwCounts;
+	std::vector<ULONGLONG> searchTicks;
+	std::vector<ULONGLONG> unwindTicks;
+	std::vector<ULONGLONG> stackClassIds;
+	std::vector<ULONG> stackIds;
+	std::vector<ULONG> stackCounts;
 
-	LOG_TRACE(L"FinalizeableObjectQueued\n");
-#ifndef PIN_INVESTIGATION
-	// TODO FIX NOW HACK for exchange data collection 
-	ClassID classID = 0;
-	m_info->GetClassFromObject(objectID, &classID);
-	EventWriteFinalizeableObjectQueuedEvent(objectID, classID);
-#endif
-	return S_OK;
+	EnterCriticalSection(&m_lock);
+	for (auto it = m_classInfo.begin(); it != m_classInfo.end(); ++it)
+	{
+		if (it->second != NULL && it->second->ThrowCount != 0)
+		{
+			classIds.push_back(it->first);
+			throwCounts.push_back(it->second->ThrowCount);
+			searchTicks.push_back(it->second->ExceptionSearchTicks);
+			unwindTicks.push_back(it->second->ExceptionUnwindTicks);
+		}
+	}
+	for (auto it = m_exceptionStacks.begin(); it != m_exceptionStacks.end(); ++it)
+	{
+		stackClassIds.push_back(it->first.first);
+		stackIds.push_back(it->first.second);
+		stackCounts.push_back(it->second);
+	}
+	LeaveCriticalSection(&m_lock);
+
+	ULONGLONG ticksPerSecond = TscTicksPerSecond();
+	const int maxCount = MaxEventPayload / (3 * sizeof(ULONGLONG) + sizeof(ULONG));
+	ULONG classCount = (ULONG)classIds.size();
+	for (ULONG idx = 0; idx < classCount; idx += maxCount)
+	{
+		EventWriteExceptionCountsEvent(ticksPerSecond, min(classCount - idx, maxCount), &classIds[idx], &throwCounts[idx], 
+			&searchTicks[idx], &unwindTicks[idx]);
+	}
+
+	const int maxStacks = MaxEventPayload / (sizeof(ULONGLONG) + 2 * sizeof(ULONG));
+	ULONG stackCount = (ULONG)stackIds.size();
+	for (ULONG idx = 0; idx < stackCount; idx += maxStacks)
+	{
+		EventWriteExceptionStacksEvent(m_exceptionStackRate, min(stackCount - idx, maxStacks), &stackClassIds[idx], 
+			&stackIds[idx], &stackCounts[idx]);
+	}
 }
 
 //==============================================================================
-STDMETHODIMP CorProfilerTracer::MovedReferences(ULONG cMovedObjectIDRanges, ObjectID oldObjectIDRangeStart[], ObjectID newObjectIDRangeStart[], ULONG cObjectIDRangeLength[])
+// Logs CpuSampleCounts events with the number of samples of each stack in 'sampleCounts'.  
+void CorProfilerTracer::LogCpuSamples(const std::unordered_map<ULONG, ULONG>& sampleCounts)
 {
-	LOG_TRACE(L"Moved Ref\n");
-	const int maxCount = MaxEventPayload / (1 * sizeof(int) + 2 * sizeof(void*));
-	for (ULONG idx = 0; idx < cMovedObjectIDRanges; idx += maxCount)
+	std::vector<ULONG> stackIds;
+	std::vector<ULONG> counts;
+	stackIds.reserve(sampleCounts.size());
+	counts.reserve(sampleCounts.size());
+	for (auto it = sampleCounts.begin(); it != sampleCounts.end(); ++it)
 	{
-		EventWriteObjectsMovedEvent(min(cMovedObjectIDRanges - idx, maxCount),
-			(const void**)&oldObjectIDRangeStart[idx], (const void**)&newObjectIDRangeStart[idx], (const unsigned int*)&cObjectIDRangeLength[idx]);
+		stackIds.push_back(it->first);
+		counts.push_back(it->second);
 	}
-	return S_OK;
+
+	const int maxCount = MaxEventPayload / (2 * sizeof(ULONG));
+	ULONG stackCount = (ULONG)stackIds.size();
+	for (ULONG idx = 0; idx < stackCount; idx += maxCount)
+		EventWriteCpuSampleCountsEvent(m_cpuSampleIntervalMSec, min(stackCount - idx, maxCount), &stackIds[idx], &counts[idx]);
 }
 
 //==============================================================================
-STDMETHODIMP CorProfilerTracer::SurvivingReferences(ULONG cSurvivingObjectIDRanges, ObjectID objectIDRangeStart[], ULONG cObjectIDRangeLength[])
+// The CpuSamples thread.  It samples the managed threads every m_cpuSampleIntervalMSec (PerfView_CpuSampleMSec) 
+// and logs the counts it has accumulated every CpuSampleLogIntervalMSec (and when it is stopped).  
+DWORD WINAPI CorProfilerTracer::CpuSampleThreadProc(LPVOID context)
 {
-	LOG_TRACE(L"Surviving references\n");
-	const int maxCount = MaxEventPayload / (1 * sizeof(int) + 1 * sizeof(void*));
-	for (ULONG idx = 0; idx < cSurvivingObjectIDRanges; idx += maxCount)
+	CorProfilerTracer* tracer = (CorProfilerTracer*)context;
+	std::unordered_map<ULONG, ULONG> sampleCounts;
+	DWORD lastLogTick = GetTickCount();
+	while (WaitForSingleObject(tracer->m_cpuSampleStopEvent, tracer->m_cpuSampleIntervalMSec) == WAIT_TIMEOUT)
 	{
-		EventWriteObjectsSurvivedEvent(min(cSurvivingObjectIDRanges - idx, maxCount),
-			(const void**)&objectIDRangeStart[idx], (const unsigned int*)&cObjectIDRangeLength[idx]);
+		tracer->SampleThreads(sampleCounts);
+		if (GetTickCount() - lastLogTick >= CpuSampleLogIntervalMSec)
+		{
+			tracer->LogCpuSamples(sampleCounts);
+			sampleCounts.clear();
+			lastLogTick = GetTickCount();
+		}
 	}
-	return S_OK;
+	tracer->LogCpuSamples(sampleCounts);
+	return 0;
 }
 
 //==============================================================================
-STDMETHODIMP CorProfilerTracer::RootReferences2(ULONG cRootRefs, ObjectID rootRefIds[], COR_PRF_GC_ROOT_KIND rootKinds[], COR_PRF_GC_ROOT_FLAGS rootFlags[], UINT_PTR rootIds[])
+// The thread that periodically logs the summaries we accumulate in process (when PerfView_SummaryFlushMSec is set). 
+DWORD WINAPI CorProfilerTracer::FlushThreadProc(LPVOID context)
 {
-	// If we did not ask for the GCHeap events, do nothing.  
-	if ((m_currentKeywords & GCHeapKeyword) == 0)
-		return S_OK;
-
-	LOG_TRACE(L"RootReferences2\n");
-	const int maxCount = MaxEventPayload / (2 * sizeof(int) + 2 * sizeof(void*));
-	for (ULONG idx = 0; idx < cRootRefs; idx += maxCount)
+	CorProfilerTracer* tracer = (CorProfilerTracer*)context;
+	while (WaitForSingleObject(tracer->m_flushStopEvent, tracer->m_flushIntervalMSec) == WAIT_TIMEOUT)
 	{
-		EventWriteRootReferencesEvent(min(cRootRefs - idx, maxCount),
-			(const void**)&rootRefIds[idx], (unsigned int*)&rootKinds[idx], (unsigned int*)&rootFlags[idx], (const void**)&rootIds[idx]);
+		if ((tracer->m_currentKeywords & CallCountKeyword) != 0)
+			tracer->LogCallCounts();
+		if ((tracer->m_currentKeywords & CallGraphKeyword) != 0)
+			tracer->LogCallEdges();
+		if ((tracer->m_currentKeywords & CallTreeKeyword) != 0)
+			tracer->LogCallTree();
+		if ((tracer->m_currentKeywords & MethodLatencyKeyword) != 0)
+			tracer->LogMethodLatency();
+		if ((tracer->m_currentKeywords & JitLatencyKeyword) != 0)
+			tracer->LogJitTimes();
+		if ((tracer->m_currentKeywords & JitInliningKeyword) != 0)
+			tracer->LogJitInlines();
+		if ((tracer->m_currentKeywords & ExceptionsKeyword) != 0)
+			tracer->LogExceptions();
+		if ((tracer->m_currentKeywords & TransitionsKeyword) != 0)
+			tracer->LogTransitions();
 	}
-	return S_OK;
+	return 0;
 }
 
 //==============================================================================
-STDMETHODIMP CorProfilerTracer::ObjectReferences(ObjectID objectId, ClassID classId, ULONG cObjectRefs, ObjectID objectRefIds[])
+// Logs a FinalizerSummary event for the types that had the most objects queued for finalization 
+// in this GC (sorted so the most is first), and resets the counts for the next GC.  
+void CorProfilerTracer::LogFinalizerSummary()
 {
-	if ((m_currentKeywords & GCHeapKeyword) == 0)
-		return S_OK;
-	// LOG_TRACE(L"ObjectReferences\n");
+	EnterCriticalSection(&m_lock);
+	unsigned int totalQueued = 0;
+	for (auto it = m_finalizedClasses.begin(); it != m_finalizedClasses.end(); ++it)
+		totalQueued += (*it)->FinalizeQueuedCount;
 
-	// We do this for the side effect of logging the class  
-	(void)GetClassInfo(classId);
-	/** TODO FIX NOW
-	if (classInfo == NULL)
-	return E_FAIL;
-	**/
-	ULONG size = 0;
-	m_info->GetObjectSize(objectId, &size);
+	size_t topCount = min(m_finalizedClasses.size(), (size_t) FinalizerSummaryTopN);
+	std::partial_sort(m_finalizedClasses.begin(), m_finalizedClasses.begin() + topCount, m_finalizedClasses.end(),
+		[](const ClassInfo* a, const ClassInfo* b) { return a->FinalizeQueuedCount > b->FinalizeQueuedCount; });
 
-	EventWriteObjectReferencesEvent(objectId, classId, size, cObjectRefs, (const void**)objectRefIds);
-	return S_OK;
+	for (size_t i = 0; i < topCount; i++)
+	{
+		ClassInfo* classInfo = m_finalizedClasses[i];
+		EventWriteFinalizerSummaryEvent(m_gcCount, (unsigned int)i, classInfo->ID, classInfo->FinalizeQueuedCount, totalQueued);
+	}
+
+	for (auto it = m_finalizedClasses.begin(); it != m_finalizedClasses.end(); ++it)
+		(*it)->FinalizeQueuedCount = 0;
+	m_finalizedClasses.clear();
+	LeaveCriticalSection(&m_lock);
 }
 
 //==============================================================================
-STDMETHODIMP CorProfilerTracer::HandleCreated(GCHandleID handleId, ObjectID initialObjectId)
+// Logs a GCHandleSummary event for every type that has live handles, which has the number of handles
+// and a histogram of how many GCs they have been alive.   This is what the GCHandleSummary keyword 
+// gives you instead of an event for every HandleCreated and HandleDestroyed.  This is called at the end of a GC 
+// and at capture state (on different threads), so it only uses locals.  
+void CorProfilerTracer::LogHandleSummary()
 {
-	if ((m_currentKeywords & (GCHeapKeyword | GCAllocKeyword | GCAllocSampledKeyword)) == 0)
-		return S_OK;
+	m_lastHandleSummaryTick = GetTickCount();
 
-	LOG_TRACE(L"HandleCreated\n");
-#ifndef PIN_INVESTIGATION
-	// TODO FIX NOW HACK for exchange data collection 
-	EventWriteHandleCreatedEvent(handleId, initialObjectId);
-#endif
-	return S_OK;
-}
+	// Copy out the live handles so we hold the handle lock only briefly, then sort them by type.  
+	std::vector<LiveHandle> handles;
+	EnterCriticalSection(&m_handleLock);
+	handles.reserve(m_liveHandles->Capacity());
+	for (ULONG i = 0; i < m_liveHandles->Capacity(); i++)
+	{
+		const LiveHandle& handle = (*m_liveHandles)[i];
+		if (handle.HandleID != 0)
+			handles.push_back(handle);
+	}
+	LeaveCriticalSection(&m_handleLock);
 
-//==============================================================================
-STDMETHODIMP CorProfilerTracer::HandleDestroyed(GCHandleID handleId)
-{
-	if ((m_currentKeywords & (GCHeapKeyword | GCAllocKeyword | GCAllocSampledKeyword)) == 0)
-		return S_OK;
+	std::sort(handles.begin(), handles.end(), [](const LiveHandle& a, const LiveHandle& b) { return a.InitialClassID < b.InitialClassID; });
 
-	LOG_TRACE(L"HandleDestroyed\n");
-#ifndef PIN_INVESTIGATION
-	// TODO FIX NOW HACK for exchange data collection 
-	EventWriteHandleDestroyedEvent(handleId);
-#endif 
-	return S_OK;
+	unsigned int ageCounts[HandleAgeBucketCount];
+	size_t idx = 0;
+	while (idx < handles.size())
+	{
+		ClassID classId = handles[idx].InitialClassID;
+		memset(ageCounts, 0, sizeof(ageCounts));
+		unsigned int handleCount = 0;
+		for (; idx < handles.size() && handles[idx].InitialClassID == classId; idx++)
+		{
+			int age = m_gcCount - handles[idx].CreationGC;
+			int bucket = 0;
+			while (bucket < HandleAgeBucketCount - 1 && (age >> bucket) != 0)
+				bucket++;
+			ageCounts[bucket]++;
+			handleCount++;
+		}
+
+		// We do this for the side effect of logging the class  
+		if (classId != 0)
+		{
+			EnterCriticalSection(&m_lock);
+			(void)GetClassInfo(classId);
+			LeaveCriticalSection(&m_lock);
+		}
+		EventWriteGCHandleSummaryEvent(m_gcCount, classId, handleCount, HandleAgeBucketCount, ageCounts);
+	}
 }
 
 //==============================================================================
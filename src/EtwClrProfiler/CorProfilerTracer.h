@@ -8,10 +8,54 @@
 #include <corhlpr.h>
 #pragma warning(pop)
 
+#include <map>
 #include <unordered_map> 
+#include <vector>
 
 class ClassInfo;
 class ModuleInfo;
+class FunctionInfo;
+class LiveHandleTable;
+class CallCountTable;
+class CallTree;
+class MethodLatencyHistogram;
+class StackTable;
+struct FrameCacheEntry;
+class PerfMapWriter;
+class StartupThreadLog;
+
+// A contiguous range of live objects reported by the GC (MovedReferences or SurvivingReferences) 
+struct ObjectRange
+{
+	ObjectID Start;
+	ULONGLONG Length;
+};
+
+// What we remember about a GC handle that is alive (created but not yet destroyed)
+struct LiveHandle
+{
+	GCHandleID HandleID;		// 0 means this is an unused entry
+	ClassID InitialClassID;		// The type of the object the handle was created with (0 if it was created null)
+	int CreationGC;				// The GC count at the time the handle was created.  
+};
+
+// A string that the DuplicateStrings keyword thinks is duplicated (and one instance of it)
+struct DuplicateStringCandidate
+{
+	DuplicateStringCandidate() : Hash(0), Instance(0), Size(0), Count(0) {}
+	ULONGLONG Hash;				// The hash of the string's characters
+	ObjectID Instance;			// One instance of the string (only valid during the GC that found it)
+	ULONG Size;					// The size of one instance in bytes.  
+	unsigned int Count;			// The estimated number of instances.  
+};
+
+// A managed thread that CpuSamples can sample
+struct SampledThread
+{
+	DWORD OSThreadID;			// 0 until the thread is assigned to an OS thread
+	HANDLE Handle;				// The OS thread (NULL if we could not open it)
+	ULONG64 Cycles;				// The thread's cycle time when we last looked at it
+};
 
 // ==========================================================================
 // CorProfileTracer is the main routine that implemented that .NET Profiler
@@ -45,7 +89,7 @@ public:
 		/* [in] */ IUnknown *pCorProfilerInfoUnk,
 		/* [in] */ void *pvClientData,
 		/* [in] */ UINT cbClientData);
-	HRESULT STDMETHODCALLTYPE ProfilerAttachComplete(void) { return S_OK; };
+	HRESULT STDMETHODCALLTYPE ProfilerAttachComplete(void);
 	HRESULT STDMETHODCALLTYPE ProfilerDetachSucceeded(void)
 	{
 		LOG_TRACE(L"ProfilerDetachSucceeded\n");
@@ -56,29 +100,29 @@ public:
 	STDMETHODIMP AppDomainCreationFinished(AppDomainID, HRESULT) { return S_OK; };
 	STDMETHODIMP AppDomainShutdownStarted(AppDomainID) { return S_OK; };
 	STDMETHODIMP AppDomainShutdownFinished(AppDomainID, HRESULT) { return S_OK; };
-	STDMETHODIMP AssemblyLoadStarted(AssemblyID) { return S_OK; };
-	STDMETHODIMP AssemblyLoadFinished(AssemblyID, HRESULT) { return S_OK; };
+	STDMETHODIMP AssemblyLoadStarted(AssemblyID assemblyId);
+	STDMETHODIMP AssemblyLoadFinished(AssemblyID assemblyId, HRESULT hrStatus);
 	STDMETHODIMP AssemblyUnloadStarted(AssemblyID) { return S_OK; };
 	STDMETHODIMP AssemblyUnloadFinished(AssemblyID, HRESULT) { return S_OK; };
-	STDMETHODIMP ModuleLoadStarted(ModuleID) { return S_OK; };
-	STDMETHODIMP ModuleLoadFinished(ModuleID, HRESULT) { return S_OK; };
+	STDMETHODIMP ModuleLoadStarted(ModuleID moduleId);
+	STDMETHODIMP ModuleLoadFinished(ModuleID moduleId, HRESULT hrStatus);
 	STDMETHODIMP ModuleUnloadStarted(ModuleID) { return S_OK; };
 	STDMETHODIMP ModuleUnloadFinished(ModuleID, HRESULT) { return S_OK; };
 	STDMETHODIMP ModuleAttachedToAssembly(ModuleID moduleId, AssemblyID assemblyId);
-	STDMETHODIMP ClassLoadStarted(ClassID) { return S_OK; };
-	STDMETHODIMP ClassLoadFinished(ClassID, HRESULT) { return S_OK; };
+	STDMETHODIMP ClassLoadStarted(ClassID classId);
+	STDMETHODIMP ClassLoadFinished(ClassID classId, HRESULT hrStatus);
 	STDMETHODIMP ClassUnloadStarted(ClassID) { return S_OK; };
 	STDMETHODIMP ClassUnloadFinished(ClassID, HRESULT) { return S_OK; };
 	STDMETHODIMP FunctionUnloadStarted(FunctionID) { return S_OK; };
-	STDMETHODIMP JITCompilationStarted(FunctionID, BOOL) { return S_OK; };
-	STDMETHODIMP JITCompilationFinished(FunctionID, HRESULT, BOOL) { return S_OK; };
+	STDMETHODIMP JITCompilationStarted(FunctionID functionId, BOOL fIsSafeToBlock);
+	STDMETHODIMP JITCompilationFinished(FunctionID functionId, HRESULT hrStatus, BOOL fIsSafeToBlock);
 	STDMETHODIMP JITCachedFunctionSearchStarted(FunctionID, BOOL *) { return S_OK; };
 	STDMETHODIMP JITCachedFunctionSearchFinished(FunctionID, COR_PRF_JIT_CACHE) { return S_OK; };
 	STDMETHODIMP JITFunctionPitched(FunctionID) { return S_OK; };
-	STDMETHODIMP JITInlining(FunctionID, FunctionID, BOOL *) { return S_OK; };
-	STDMETHODIMP ThreadCreated(ThreadID) { return S_OK; };
-	STDMETHODIMP ThreadDestroyed(ThreadID) { return S_OK; };
-	STDMETHODIMP ThreadAssignedToOSThread(ThreadID, ULONG) { return S_OK; };
+	STDMETHODIMP JITInlining(FunctionID callerId, FunctionID calleeId, BOOL* pfShouldInline);
+	STDMETHODIMP ThreadCreated(ThreadID threadId);
+	STDMETHODIMP ThreadDestroyed(ThreadID threadId);
+	STDMETHODIMP ThreadAssignedToOSThread(ThreadID managedThreadId, DWORD osThreadId);
 	STDMETHODIMP RemotingClientInvocationStarted() { return S_OK; };
 	STDMETHODIMP RemotingClientSendingMessage(GUID *, BOOL) { return S_OK; };
 	STDMETHODIMP RemotingClientReceivingReply(GUID *, BOOL) { return S_OK; };
@@ -87,21 +131,21 @@ public:
 	STDMETHODIMP RemotingServerInvocationStarted() { return S_OK; };
 	STDMETHODIMP RemotingServerInvocationReturned() { return S_OK; };
 	STDMETHODIMP RemotingServerSendingReply(GUID *, BOOL) { return S_OK; };
-	STDMETHODIMP UnmanagedToManagedTransition(FunctionID, COR_PRF_TRANSITION_REASON) { return S_OK; };
-	STDMETHODIMP ManagedToUnmanagedTransition(FunctionID, COR_PRF_TRANSITION_REASON) { return S_OK; };
-	STDMETHODIMP RuntimeSuspendStarted(COR_PRF_SUSPEND_REASON) { return S_OK; };
-	STDMETHODIMP RuntimeSuspendFinished() { return S_OK; };
-	STDMETHODIMP RuntimeSuspendAborted() { return S_OK; };
-	STDMETHODIMP RuntimeResumeStarted() { return S_OK; };
-	STDMETHODIMP RuntimeResumeFinished() { return S_OK; };
-	STDMETHODIMP RuntimeThreadSuspended(ThreadID) { return S_OK; };
+	STDMETHODIMP UnmanagedToManagedTransition(FunctionID functionId, COR_PRF_TRANSITION_REASON reason);
+	STDMETHODIMP ManagedToUnmanagedTransition(FunctionID functionId, COR_PRF_TRANSITION_REASON reason);
+	STDMETHODIMP RuntimeSuspendStarted(COR_PRF_SUSPEND_REASON suspendReason);
+	STDMETHODIMP RuntimeSuspendFinished();
+	STDMETHODIMP RuntimeSuspendAborted();
+	STDMETHODIMP RuntimeResumeStarted();
+	STDMETHODIMP RuntimeResumeFinished();
+	STDMETHODIMP RuntimeThreadSuspended(ThreadID threadId);
 	STDMETHODIMP RuntimeThreadResumed(ThreadID) { return S_OK; };
 	STDMETHODIMP MovedReferences(ULONG cMovedObjectIDRanges, ObjectID oldObjectIDRangeStart[], ObjectID newObjectIDRangeStart[], ULONG cObjectIDRangeLength[]);
 	STDMETHODIMP ObjectAllocated(ObjectID objectId, ClassID classId);
 	STDMETHODIMP ObjectsAllocatedByClass(ULONG, ClassID[], ULONG[]) { return S_OK; };
 	STDMETHODIMP ObjectReferences(ObjectID objectId, ClassID classId, ULONG cObjectRefs, ObjectID objectRefIds[]);
 	STDMETHODIMP RootReferences(ULONG, ObjectID[]) { return S_OK; }
-	STDMETHODIMP ExceptionThrown(ObjectID) { return S_OK; };
+	STDMETHODIMP ExceptionThrown(ObjectID thrownObjectId);
 	STDMETHODIMP ExceptionSearchFunctionEnter(FunctionID) { return S_OK; };
 	STDMETHODIMP ExceptionSearchFunctionLeave() { return S_OK; };
 	STDMETHODIMP ExceptionSearchFilterEnter(FunctionID) { return S_OK; };
@@ -109,11 +153,11 @@ public:
 	STDMETHODIMP ExceptionSearchCatcherFound(FunctionID) { return S_OK; };
 	STDMETHODIMP ExceptionOSHandlerEnter(FunctionID) { return S_OK; };
 	STDMETHODIMP ExceptionOSHandlerLeave(FunctionID) { return S_OK; };
-	STDMETHODIMP ExceptionUnwindFunctionEnter(FunctionID) { return S_OK; };
-	STDMETHODIMP ExceptionUnwindFunctionLeave() { return S_OK; };
+	STDMETHODIMP ExceptionUnwindFunctionEnter(FunctionID functionId);
+	STDMETHODIMP ExceptionUnwindFunctionLeave();
 	STDMETHODIMP ExceptionUnwindFinallyEnter(FunctionID) { return S_OK; };
 	STDMETHODIMP ExceptionUnwindFinallyLeave() { return S_OK; };
-	STDMETHODIMP ExceptionCatcherEnter(FunctionID, ObjectID) { return S_OK; };
+	STDMETHODIMP ExceptionCatcherEnter(FunctionID functionId, ObjectID objectId);
 	STDMETHODIMP ExceptionCatcherLeave() { return S_OK; };
 	STDMETHODIMP COMClassicVTableCreated(ClassID, REFGUID, void *, ULONG) { return S_OK; };
 	STDMETHODIMP COMClassicVTableDestroyed(ClassID, REFGUID, void *) { return S_OK; };
@@ -135,11 +179,57 @@ public:
 	STDMETHODIMP HandleDestroyed(GCHandleID handleId);
 
 	void DoETWCommand(ULONG IsEnabled, UCHAR Level, ULONGLONG MatchAnyKeywords, struct _EVENT_FILTER_DESCRIPTOR* filterData);
+	CallCountTable* NewCallCountTable();
+	CallCountTable* NewCallEdgeTable();
+	bool GetFunctionFromIP(UINT_PTR ip, FunctionID* functionId);
+	CallTree* NewCallTree();
+	bool SelectHookedFunction(FunctionID functionId, bool* isAnchor);
+	void DefineFunctions(const ULONGLONG* functionIds, size_t count);
+	FrameCacheEntry* NewFrameCache();
+	ULONG InternStack(const ULONGLONG* frames, ULONG count);
 private: // Methods
 	ClassInfo* GetClassInfo(ClassID classId);
 	ModuleInfo* GetModuleInfo(ModuleID moduleId);
+	FunctionInfo* GetFunctionInfo(FunctionID functionId);
 	void ClearTables();
 	void DumpClassInfo();
+	void LogGCFragmentation();
+	void LogHandleSummary();
+	void LogFinalizerSummary();
+	void LogGCPromotion();
+	void CountString(ObjectID objectId);
+	void LogDuplicateStrings();
+	void ScanArray(ObjectID objectId, ClassInfo* classInfo);
+	void LogArrayWaste();
+	void LogHeapSampleSummary();
+	void LogCallCounts();
+	void LogCallEdges();
+	void LogCallTree();
+	void LogMethodLatency();
+	void LogJitTimes();
+	void LogJitInlines();
+	void LogGCPauseHistograms();
+	void LogSafePoints();
+	void EndExceptionPhase(BYTE nextPhase);
+	void LogExceptions();
+	CallCountTable* GetTransitionTable();
+	void LogTransitions();
+	void StartPerfMap();
+	StartupThreadLog* GetStartupLog();
+	void StartupActivityStart(BYTE kind, ULONGLONG id);
+	void StartupActivityStop(BYTE kind, ULONGLONG id, bool succeeded);
+	void LogStartupTimeline();
+	void AddToPerfMap(FunctionID functionId);
+	ULONGLONG TscTicksPerSecond();
+	static DWORD WINAPI FlushThreadProc(LPVOID context);
+	void StartCpuSampling();
+	void StopCpuSampling();
+	ULONG SnapshotStack(ThreadID threadId, const SampledThread& thread);
+	void SampleThreads(std::unordered_map<ULONG, ULONG>& sampleCounts);
+	void LogCpuSamples(const std::unordered_map<ULONG, ULONG>& sampleCounts);
+	static DWORD WINAPI CpuSampleThreadProc(LPVOID context);
+	bool InPromotionBounds(ObjectID objectId);
+	bool GetGenerationBounds(std::vector<COR_PRF_GC_GENERATION_RANGE>& bounds, ULONG* pBoundsCount);
 	static DWORD WINAPI ForceGCBody(LPVOID lpParameter);
 	void ForceGC();
 
@@ -160,9 +250,123 @@ private: // Fields
 	int					     m_curAllocSize;
 	// Do we have smart sampling that does sampling per type after a certain number of instances are collected.  
 	bool					 m_smartSampling;
+	// The sampling rate CallSampled uses (Call always uses 1).  
+	ULONG					 m_callSamplingRate;
+	// For CallCount, CallGraph, CallTree, CallStacks, JitInlining, StartupTimeline and Transitions, the threads' call count 
+	// tables, call edge tables, call trees, return address caches, inlining tables, startup logs and transition tables, 
+	// and the total counts and merged tree of the threads that died (protected by m_callCountLock)
+	CRITICAL_SECTION		 m_callCountLock;
+	std::unordered_map<ThreadID, CallCountTable*> m_callCountTables;
+	std::unordered_map<FunctionID, ULONGLONG> m_deadThreadCallCounts;
+	std::vector<CallCountTable*> m_callEdgeTables;
+	std::unordered_map<ThreadID, CallTree*> m_callTrees;
+	CallTree*				 m_deadThreadCallTree;
+	std::vector<FrameCacheEntry*> m_frameCaches;
+	std::vector<CallCountTable*> m_jitInlineTables;
+	std::vector<StartupThreadLog*> m_startupLogs;
+	std::vector<CallCountTable*> m_transitionTables;
+	// For CallStacks and CpuSamples, the stacks we have logged StackDefinition events for.  
+	StackTable*				 m_stacks;
+	// For CpuSamples, the live managed threads (protected by m_threadLock), and the thread that samples them.  
+	CRITICAL_SECTION		 m_threadLock;
+	std::unordered_map<ThreadID, SampledThread> m_threads;
+	DWORD					 m_cpuSampleIntervalMSec;
+	HANDLE					 m_cpuSampleThread;
+	HANDLE					 m_cpuSampleStopEvent;
+	// For JitLatency, the histogram of all JIT compile times (the per method and module totals are in their infos).  
+	MethodLatencyHistogram*	 m_jitHistogram;
+	// For PerfMap, writes the perf map file.  
+	PerfMapWriter*			 m_perfMap;
+	// For GCPauses, the histograms of each PausePhase for each suspend reason (indexed by reason * PausePhaseCount + phase, 
+	// NULL until we see one).  For GCPauses and SafePoints, when the current suspension's phases started and finished (0 if they have not).  
+	std::vector<MethodLatencyHistogram*> m_pauseHistograms;
+	COR_PRF_SUSPEND_REASON	 m_suspendReason;
+	ULONGLONG				 m_suspendStartTicks;
+	ULONGLONG				 m_suspendFinishTicks;
+	ULONGLONG				 m_gcStartTicks;
+	ULONGLONG				 m_gcFinishTicks;
+	ULONGLONG				 m_resumeStartTicks;
+	int						 m_pauseGCCount;
+	DWORD					 m_lastPauseHistogramTick;
+	// For SafePoints, when each thread was suspended in the current suspension (protected by m_safePointLock), 
+	// and whether we walk the slowest threads' stacks (PerfView_SafePointStacks).  
+	CRITICAL_SECTION		 m_safePointLock;
+	std::vector<std::pair<ThreadID, ULONGLONG>> m_safePoints;
+	bool					 m_safePointStacks;
+	// For Exceptions, the number of sampled throws of each exception type from each stack (protected by m_lock), 
+	// and the sampling rate (the counts and times are in the ClassInfos).  
+	std::map<std::pair<ClassID, ULONG>, ULONG> m_exceptionStacks;
+	ULONG					 m_exceptionStackRate;
+	// For StartupTimeline, when startup started, how long it lasts, and whether we have logged the timeline.  
+	DWORD					 m_startupStartTick;
+	DWORD					 m_startupWindowMSec;
+	volatile LONG			 m_startupLogged;
+	// For CallTree, did we install the leave hooks and how many times have we logged the trees. 
+	bool					 m_callTreeHooks;
+	ULONG					 m_callTreeFlushCount;
+	// For MethodLatency, did PerfView_MethodLatency select methods (its patterns), and their histograms (protected by m_lock).  
+	bool					 m_methodLatencyHooks;
+	wchar_t					 m_methodLatencyPatterns[1024];
+	std::vector<MethodLatencyHistogram*> m_methodLatencies;
+	// For CallScoped, did PerfView_CallScopeAnchors select anchors (its patterns), and how many did it select.  
+	bool					 m_callScopeHooks;
+	wchar_t					 m_callScopeAnchors[1024];
+	ULONG					 m_callScopeAnchorCount;
+	// When we started, so we can tell how fast the time stamp counter ticks.  
+	LARGE_INTEGER			 m_tscStartQpc;
+	ULONGLONG				 m_tscStartTsc;
+	// The thread that periodically logs the in process summaries (if m_flushIntervalMSec is not 0)
+	DWORD					 m_flushIntervalMSec;
+	HANDLE					 m_flushThread;
+	HANDLE					 m_flushStopEvent;
 	int						 m_gcCount;
 
-	// We want to cache the information (e.g. name, token, ...) on classes and modules.  
+	// For GCFragmentation, set during full GCs.  The post-GC location of every object range that survived the current GC, 
+	// and the generation bounds after the GC.  These are cleared (not freed) between GCs so we don't allocate in steady state.  
+	bool					 m_analyzeFragmentation;
+	std::vector<ObjectRange> m_survivorRanges;
+	std::vector<COR_PRF_GC_GENERATION_RANGE> m_generationBounds;
+
+	// For GCHandleSummary, the table of live handles (protected by m_handleLock) and when we last summarized them. 
+	CRITICAL_SECTION		 m_handleLock;
+	LiveHandleTable*		 m_liveHandles;
+	DWORD					 m_lastHandleSummaryTick;
+
+	// For FinalizerSummary, the types that have had objects queued for finalization in this GC (protected by m_lock) 
+	std::vector<ClassInfo*>	 m_finalizedClasses;
+
+	// For GCPromotion, the generation whose survivors we are tracking in this GC (-1 if none), where it was before 
+	// the GC, and where its survivors are after the GC.  The sampled counts are kept in the ClassInfo. 
+	int									m_promotionGeneration;
+	std::vector<COR_PRF_GC_GENERATION_RANGE> m_promotionBounds;
+	std::vector<ObjectRange>			m_promotedRanges;
+	std::vector<ClassInfo*>				m_promotedClasses;
+	int									m_promotionSampleCountdown;
+
+	// For DuplicateStrings, set during full GCs.  The count-min sketch of string hashes and the most duplicated strings so far. 
+	bool								m_analyzeStrings;
+	ClassID								m_stringClassId;
+	ULONG								m_stringLengthOffset;
+	ULONG								m_stringBufferOffset;
+	std::vector<unsigned int>			m_stringSketch;
+	std::vector<DuplicateStringCandidate> m_stringCandidates;
+
+	// For ArrayWaste, set during full GCs.  The per type counts are kept in the ClassInfo. 
+	bool								m_analyzeArrays;
+	ULONG								m_arrayWasteMinSize;
+	ULONG								m_arrayScanBudget;		// The bytes we can still scan in this GC
+	std::vector<ClassInfo*>				m_arrayWasteClasses;
+
+	// For GCHeapSampled, the types that had objects we did not log in this GC's heap walk (the counts are kept in the ClassInfo), 
+	// and the buffers we use to log them.  
+	ULONG								m_heapSampleRate;
+	std::vector<ClassInfo*>				m_heapSampleClasses;
+	std::vector<ULONGLONG>				m_heapSampleClassIds;
+	std::vector<unsigned int>			m_heapSampleCounts;
+	std::vector<ULONGLONG>				m_heapSampleSizes;
+
+	// We want to cache the information (e.g. name, token, ...) on classes, modules and methods.  
 	std::unordered_map<ClassID, ClassInfo*> m_classInfo;
 	std::unordered_map<ModuleID, ModuleInfo*> m_moduleInfo;
+	std::unordered_map<FunctionID, FunctionInfo*> m_functionInfo;
 };
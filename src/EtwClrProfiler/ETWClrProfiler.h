@@ -271,7 +271,7 @@ McGenEventWriteUM(
 #endif // MCGEN_DISABLE_PROVIDER_CODE_GENERATION
 
 //+
-// Provider ETWClrProfiler Event Count 19
+// Provider ETWClrProfiler Event Count 49
 //+
 EXTERN_C __declspec(selectany) const GUID ETWClrProfiler = {0x6652970f, 0x1756, 0x5d8d, {0x08, 0x05, 0xe9, 0xaa, 0xd1, 0x52, 0xaa, 0x84}};
 
@@ -294,6 +294,35 @@ EXTERN_C __declspec(selectany) const GUID ETWClrProfiler = {0x6652970f, 0x1756,
 #define ETWClrProfiler_TASK_ProfilerError 0x1a
 #define ETWClrProfiler_TASK_ProfilerShutdown 0x1b
 #define ETWClrProfiler_TASK_CallEnter 0x1d
+#define ETWClrProfiler_TASK_GCFragmentation 0x1e
+#define ETWClrProfiler_TASK_GCHandleSummary 0x1f
+#define ETWClrProfiler_TASK_FinalizerSummary 0x20
+#define ETWClrProfiler_TASK_GCPromotion 0x21
+#define ETWClrProfiler_TASK_DuplicateString 0x22
+#define ETWClrProfiler_TASK_ArrayWaste 0x23
+#define ETWClrProfiler_TASK_HeapSampleSummary 0x24
+#define ETWClrProfiler_TASK_CallCounts 0x25
+#define ETWClrProfiler_TASK_CallTree 0x26
+#define ETWClrProfiler_TASK_MethodLatency 0x27
+#define ETWClrProfiler_TASK_CallEdges 0x28
+#define ETWClrProfiler_TASK_CallScope 0x29
+#define ETWClrProfiler_TASK_FunctionIDDefinition 0x2b
+#define ETWClrProfiler_TASK_StackDefinition 0x2c
+#define ETWClrProfiler_TASK_CallStackSample 0x2d
+#define ETWClrProfiler_TASK_CpuSampleCounts 0x2e
+#define ETWClrProfiler_TASK_JitMethodTimes 0x2f
+#define ETWClrProfiler_TASK_JitModuleTimes 0x30
+#define ETWClrProfiler_TASK_JitTimeHistogram 0x31
+#define ETWClrProfiler_TASK_PerfMap 0x32
+#define ETWClrProfiler_TASK_JitInlineCounts 0x33
+#define ETWClrProfiler_TASK_StartupTimeline 0x34
+#define ETWClrProfiler_TASK_StartupAssemblyCosts 0x35
+#define ETWClrProfiler_TASK_GCPause 0x36
+#define ETWClrProfiler_TASK_GCPauseHistogram 0x37
+#define ETWClrProfiler_TASK_SafePointLaggards 0x38
+#define ETWClrProfiler_TASK_ExceptionCounts 0x39
+#define ETWClrProfiler_TASK_ExceptionStacks 0x3a
+#define ETWClrProfiler_TASK_TransitionCounts 0x3b
 #define ETWClrProfiler_TASK_SendManifest 0xfffe
 //
 // Keyword
@@ -306,13 +335,35 @@ EXTERN_C __declspec(selectany) const GUID ETWClrProfiler = {0x6652970f, 0x1756,
 #define CallKeyword 0x10
 #define CallSampledKeyword 0x20
 #define DisableInliningKeyword 0x40
+#define GCFragmentationKeyword 0x80
+#define GCHandleSummaryKeyword 0x100
+#define FinalizerSummaryKeyword 0x200
+#define GCPromotionKeyword 0x400
+#define DuplicateStringsKeyword 0x800
+#define ArrayWasteKeyword 0x1000
+#define GCHeapSampledKeyword 0x2000
+#define CallCountKeyword 0x4000
+#define CallTreeKeyword 0x8000
+#define MethodLatencyKeyword 0x10000
+#define CallGraphKeyword 0x20000
+#define CallScopedKeyword 0x40000
+#define CallStacksKeyword 0x80000
+#define CpuSamplesKeyword 0x100000
+#define JitLatencyKeyword 0x200000
+#define PerfMapKeyword 0x400000
+#define JitInliningKeyword 0x800000
+#define StartupTimelineKeyword 0x1000000
+#define GCPausesKeyword 0x2000000
+#define SafePointsKeyword 0x4000000
+#define ExceptionsKeyword 0x8000000
+#define TransitionsKeyword 0x10000000
 
 //
 // Event Descriptors
 //
-EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ClassIDDefintionEvent = {0x1, 0x0, 0x0, 0x4, 0x0, 0xa, 0xf};
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ClassIDDefintionEvent = {0x1, 0x0, 0x0, 0x4, 0x0, 0xa, 0x900370f};
 #define ClassIDDefintionEvent_value 0x1
-EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ModuleIDDefintionEvent = {0x2, 0x0, 0x0, 0x4, 0x0, 0xb, 0xf};
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ModuleIDDefintionEvent = {0x2, 0x0, 0x0, 0x4, 0x0, 0xb, 0x1dbff73f};
 #define ModuleIDDefintionEvent_value 0x2
 EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ObjectAllocatedEvent = {0xa, 0x0, 0x0, 0x5, 0x0, 0xc, 0xc};
 #define ObjectAllocatedEvent_value 0xa
@@ -322,30 +373,90 @@ EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR HandleCreatedEvent = {0xc,
 #define HandleCreatedEvent_value 0xc
 EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR HandleDestroyedEvent = {0xd, 0x0, 0x0, 0x4, 0x0, 0xf, 0xe};
 #define HandleDestroyedEvent_value 0xd
-EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR RootReferencesEvent = {0xf, 0x0, 0x0, 0x5, 0x0, 0x16, 0x2};
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR RootReferencesEvent = {0xf, 0x0, 0x0, 0x5, 0x0, 0x16, 0x2002};
 #define RootReferencesEvent_value 0xf
-EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ObjectReferencesEvent = {0x10, 0x0, 0x0, 0x5, 0x0, 0x17, 0x2};
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ObjectReferencesEvent = {0x10, 0x0, 0x0, 0x5, 0x0, 0x17, 0x2002};
 #define ObjectReferencesEvent_value 0x10
-EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR GCStartEvent = {0x14, 0x0, 0x0, 0x4, 0x1, 0x1, 0xf};
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR GCStartEvent = {0x14, 0x0, 0x0, 0x4, 0x1, 0x1, 0x200f};
 #define GCStartEvent_value 0x14
-EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR GCStopEvent = {0x15, 0x0, 0x0, 0x4, 0x2, 0x1, 0xf};
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR GCStopEvent = {0x15, 0x0, 0x0, 0x4, 0x2, 0x1, 0x200f};
 #define GCStopEvent_value 0x15
 EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ObjectsMovedEvent = {0x16, 0x0, 0x0, 0x4, 0x0, 0x14, 0xf};
 #define ObjectsMovedEvent_value 0x16
 EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ObjectsSurvivedEvent = {0x17, 0x0, 0x0, 0x4, 0x0, 0x15, 0xf};
 #define ObjectsSurvivedEvent_value 0x17
-EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR CaptureStateStart = {0x18, 0x0, 0x0, 0x3, 0x1, 0x18, 0x80000000000f};
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR CaptureStateStart = {0x18, 0x0, 0x0, 0x3, 0x1, 0x18, 0x80001fffff8f};
 #define CaptureStateStart_value 0x18
-EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR CaptureStateStop = {0x19, 0x0, 0x0, 0x3, 0x2, 0x18, 0x80000000000f};
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR CaptureStateStop = {0x19, 0x0, 0x0, 0x3, 0x2, 0x18, 0x80001fffff8f};
 #define CaptureStateStop_value 0x19
-EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ProfilerError = {0x1a, 0x0, 0x0, 0x2, 0x0, 0x1a, 0x80000000000f};
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ProfilerError = {0x1a, 0x0, 0x0, 0x2, 0x0, 0x1a, 0x80001fffff8f};
 #define ProfilerError_value 0x1a
 EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ProfilerShutdown = {0x1b, 0x0, 0x0, 0x2, 0x0, 0x1b, 0x80000000000f};
 #define ProfilerShutdown_value 0x1b
 EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR SamplingRateChange = {0x1c, 0x0, 0x0, 0x5, 0x0, 0x1c, 0x8};
 #define SamplingRateChange_value 0x1c
-EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR CallEnterEvent = {0x1d, 0x0, 0x0, 0x5, 0x0, 0x1d, 0x30};
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR CallEnterEvent = {0x1d, 0x0, 0x0, 0x5, 0x0, 0x1d, 0x40030};
 #define CallEnterEvent_value 0x1d
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR GCFragmentationEvent = {0x1e, 0x0, 0x0, 0x4, 0x0, 0x1e, 0x80};
+#define GCFragmentationEvent_value 0x1e
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR GCHandleSummaryEvent = {0x1f, 0x0, 0x0, 0x4, 0x0, 0x1f, 0x100};
+#define GCHandleSummaryEvent_value 0x1f
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR FinalizerSummaryEvent = {0x20, 0x0, 0x0, 0x4, 0x0, 0x20, 0x200};
+#define FinalizerSummaryEvent_value 0x20
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR GCPromotionEvent = {0x21, 0x0, 0x0, 0x4, 0x0, 0x21, 0x400};
+#define GCPromotionEvent_value 0x21
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR DuplicateStringEvent = {0x22, 0x0, 0x0, 0x4, 0x0, 0x22, 0x800};
+#define DuplicateStringEvent_value 0x22
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ArrayWasteEvent = {0x23, 0x0, 0x0, 0x4, 0x0, 0x23, 0x1000};
+#define ArrayWasteEvent_value 0x23
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR HeapSampleSummaryEvent = {0x24, 0x0, 0x0, 0x4, 0x0, 0x24, 0x2000};
+#define HeapSampleSummaryEvent_value 0x24
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR CallCountsEvent = {0x25, 0x0, 0x0, 0x4, 0x0, 0x25, 0x4000};
+#define CallCountsEvent_value 0x25
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR CallTreeEvent = {0x26, 0x0, 0x0, 0x4, 0x0, 0x26, 0x8000};
+#define CallTreeEvent_value 0x26
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR MethodLatencyEvent = {0x27, 0x0, 0x0, 0x4, 0x0, 0x27, 0x10000};
+#define MethodLatencyEvent_value 0x27
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR CallEdgesEvent = {0x28, 0x0, 0x0, 0x4, 0x0, 0x28, 0x20000};
+#define CallEdgesEvent_value 0x28
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR CallScopeStartEvent = {0x29, 0x0, 0x0, 0x4, 0x1, 0x29, 0x40000};
+#define CallScopeStartEvent_value 0x29
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR CallScopeStopEvent = {0x2a, 0x0, 0x0, 0x4, 0x2, 0x29, 0x40000};
+#define CallScopeStopEvent_value 0x2a
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR FunctionIDDefinitionEvent = {0x2b, 0x0, 0x0, 0x4, 0x0, 0x2b, 0x1dbfc030};
+#define FunctionIDDefinitionEvent_value 0x2b
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR StackDefinitionEvent = {0x2c, 0x0, 0x0, 0x4, 0x0, 0x2c, 0xc180000};
+#define StackDefinitionEvent_value 0x2c
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR CallStackSampleEvent = {0x2d, 0x0, 0x0, 0x5, 0x0, 0x2d, 0x80000};
+#define CallStackSampleEvent_value 0x2d
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR CpuSampleCountsEvent = {0x2e, 0x0, 0x0, 0x4, 0x0, 0x2e, 0x100000};
+#define CpuSampleCountsEvent_value 0x2e
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR JitMethodTimesEvent = {0x2f, 0x0, 0x0, 0x4, 0x0, 0x2f, 0x200000};
+#define JitMethodTimesEvent_value 0x2f
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR JitModuleTimesEvent = {0x30, 0x0, 0x0, 0x4, 0x0, 0x30, 0x200000};
+#define JitModuleTimesEvent_value 0x30
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR JitTimeHistogramEvent = {0x31, 0x0, 0x0, 0x4, 0x0, 0x31, 0x200000};
+#define JitTimeHistogramEvent_value 0x31
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR PerfMapEvent = {0x32, 0x0, 0x0, 0x4, 0x0, 0x32, 0x400000};
+#define PerfMapEvent_value 0x32
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR JitInlineCountsEvent = {0x33, 0x0, 0x0, 0x4, 0x0, 0x33, 0x800000};
+#define JitInlineCountsEvent_value 0x33
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR StartupTimelineEvent = {0x34, 0x0, 0x0, 0x4, 0x0, 0x34, 0x1000000};
+#define StartupTimelineEvent_value 0x34
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR StartupAssemblyCostsEvent = {0x35, 0x0, 0x0, 0x4, 0x0, 0x35, 0x1000000};
+#define StartupAssemblyCostsEvent_value 0x35
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR GCPauseEvent = {0x36, 0x0, 0x0, 0x4, 0x0, 0x36, 0x2000000};
+#define GCPauseEvent_value 0x36
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR GCPauseHistogramEvent = {0x37, 0x0, 0x0, 0x4, 0x0, 0x37, 0x2000000};
+#define GCPauseHistogramEvent_value 0x37
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR SafePointLaggardsEvent = {0x38, 0x0, 0x0, 0x4, 0x0, 0x38, 0x4000000};
+#define SafePointLaggardsEvent_value 0x38
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ExceptionCountsEvent = {0x39, 0x0, 0x0, 0x4, 0x0, 0x39, 0x8000000};
+#define ExceptionCountsEvent_value 0x39
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR ExceptionStacksEvent = {0x3a, 0x0, 0x0, 0x4, 0x0, 0x3a, 0x8000000};
+#define ExceptionStacksEvent_value 0x3a
+EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR TransitionCountsEvent = {0x3b, 0x0, 0x0, 0x4, 0x0, 0x3b, 0x10000000};
+#define TransitionCountsEvent_value 0x3b
 EXTERN_C __declspec(selectany) const EVENT_DESCRIPTOR SendManifestEvent = {0xfffe, 0x0, 0x0, 0x0, 0x0, 0xfffe, 0x80000000000f};
 #define SendManifestEvent_value 0xfffe
 
@@ -386,10 +497,10 @@ typedef enum _ClassDefinitionFlags
 // Event Enablement Bits
 //
 
-EXTERN_C __declspec(selectany) DECLSPEC_CACHEALIGN ULONG ETWClrProfilerEnableBits[1];
-EXTERN_C __declspec(selectany) const ULONGLONG ETWClrProfilerKeywords[10] = {0xf, 0xc, 0xd, 0xe, 0x2, 0x80000000000f, 0x80000000000f, 0x8, 0x30, 0x80000000000f};
-EXTERN_C __declspec(selectany) const UCHAR ETWClrProfilerLevels[10] = {4, 5, 4, 4, 5, 3, 2, 5, 5, 0};
-EXTERN_C __declspec(selectany) MCGEN_TRACE_CONTEXT ETWClrProfiler_Context = {0, (ULONG_PTR)ETWClrProfiler_Traits, 0, 0, 0, 0, 0, 0, 10, ETWClrProfilerEnableBits, ETWClrProfilerKeywords, ETWClrProfilerLevels};
+EXTERN_C __declspec(selectany) DECLSPEC_CACHEALIGN ULONG ETWClrProfilerEnableBits[2];
+EXTERN_C __declspec(selectany) const ULONGLONG ETWClrProfilerKeywords[38] = {0x900370f, 0x1dbff73f, 0xc, 0xd, 0xe, 0x2002, 0x200f, 0xf, 0x80001fffff8f, 0x80001fffff8f, 0x80000000000f, 0x8, 0x40030, 0x80, 0x100, 0x200, 0x400, 0x800, 0x1000, 0x2000, 0x4000, 0x8000, 0x10000, 0x20000, 0x40000, 0x1dbfc030, 0xc180000, 0x80000, 0x100000, 0x200000, 0x400000, 0x800000, 0x1000000, 0x2000000, 0x4000000, 0x8000000, 0x10000000, 0x80000000000f};
+EXTERN_C __declspec(selectany) const UCHAR ETWClrProfilerLevels[38] = {4, 4, 5, 4, 4, 5, 4, 4, 3, 2, 2, 5, 5, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 5, 4, 4, 4, 4, 4, 4, 4, 4, 4, 0};
+EXTERN_C __declspec(selectany) MCGEN_TRACE_CONTEXT ETWClrProfiler_Context = {0, (ULONG_PTR)ETWClrProfiler_Traits, 0, 0, 0, 0, 0, 0, 38, ETWClrProfilerEnableBits, ETWClrProfilerKeywords, ETWClrProfilerLevels};
 
 #define ETWClrProfilerHandle (ETWClrProfiler_Context.RegistrationHandle)
 
@@ -507,7 +618,7 @@ Remarks:
 // Enablement check macro for ModuleIDDefintionEvent
 //
 
-#define EventEnabledModuleIDDefintionEvent() ((ETWClrProfilerEnableBits[0] & 0x00000001) != 0)
+#define EventEnabledModuleIDDefintionEvent() ((ETWClrProfilerEnableBits[0] & 0x00000002) != 0)
 
 //
 // Event Macro for ModuleIDDefintionEvent
@@ -521,7 +632,7 @@ Remarks:
 // Enablement check macro for ObjectAllocatedEvent
 //
 
-#define EventEnabledObjectAllocatedEvent() ((ETWClrProfilerEnableBits[0] & 0x00000002) != 0)
+#define EventEnabledObjectAllocatedEvent() ((ETWClrProfilerEnableBits[0] & 0x00000004) != 0)
 
 //
 // Event Macro for ObjectAllocatedEvent
@@ -535,7 +646,7 @@ Remarks:
 // Enablement check macro for FinalizeableObjectQueuedEvent
 //
 
-#define EventEnabledFinalizeableObjectQueuedEvent() ((ETWClrProfilerEnableBits[0] & 0x00000004) != 0)
+#define EventEnabledFinalizeableObjectQueuedEvent() ((ETWClrProfilerEnableBits[0] & 0x00000008) != 0)
 
 //
 // Event Macro for FinalizeableObjectQueuedEvent
@@ -549,7 +660,7 @@ Remarks:
 // Enablement check macro for HandleCreatedEvent
 //
 
-#define EventEnabledHandleCreatedEvent() ((ETWClrProfilerEnableBits[0] & 0x00000008) != 0)
+#define EventEnabledHandleCreatedEvent() ((ETWClrProfilerEnableBits[0] & 0x00000010) != 0)
 
 //
 // Event Macro for HandleCreatedEvent
@@ -563,7 +674,7 @@ Remarks:
 // Enablement check macro for HandleDestroyedEvent
 //
 
-#define EventEnabledHandleDestroyedEvent() ((ETWClrProfilerEnableBits[0] & 0x00000008) != 0)
+#define EventEnabledHandleDestroyedEvent() ((ETWClrProfilerEnableBits[0] & 0x00000010) != 0)
 
 //
 // Event Macro for HandleDestroyedEvent
@@ -577,7 +688,7 @@ Remarks:
 // Enablement check macro for RootReferencesEvent
 //
 
-#define EventEnabledRootReferencesEvent() ((ETWClrProfilerEnableBits[0] & 0x00000010) != 0)
+#define EventEnabledRootReferencesEvent() ((ETWClrProfilerEnableBits[0] & 0x00000020) != 0)
 
 //
 // Event Macro for RootReferencesEvent
@@ -591,7 +702,7 @@ Remarks:
 // Enablement check macro for ObjectReferencesEvent
 //
 
-#define EventEnabledObjectReferencesEvent() ((ETWClrProfilerEnableBits[0] & 0x00000010) != 0)
+#define EventEnabledObjectReferencesEvent() ((ETWClrProfilerEnableBits[0] & 0x00000020) != 0)
 
 //
 // Event Macro for ObjectReferencesEvent
@@ -605,7 +716,7 @@ Remarks:
 // Enablement check macro for GCStartEvent
 //
 
-#define EventEnabledGCStartEvent() ((ETWClrProfilerEnableBits[0] & 0x00000001) != 0)
+#define EventEnabledGCStartEvent() ((ETWClrProfilerEnableBits[0] & 0x00000040) != 0)
 
 //
 // Event Macro for GCStartEvent
@@ -619,7 +730,7 @@ Remarks:
 // Enablement check macro for GCStopEvent
 //
 
-#define EventEnabledGCStopEvent() ((ETWClrProfilerEnableBits[0] & 0x00000001) != 0)
+#define EventEnabledGCStopEvent() ((ETWClrProfilerEnableBits[0] & 0x00000040) != 0)
 
 //
 // Event Macro for GCStopEvent
@@ -633,7 +744,7 @@ Remarks:
 // Enablement check macro for ObjectsMovedEvent
 //
 
-#define EventEnabledObjectsMovedEvent() ((ETWClrProfilerEnableBits[0] & 0x00000001) != 0)
+#define EventEnabledObjectsMovedEvent() ((ETWClrProfilerEnableBits[0] & 0x00000080) != 0)
 
 //
 // Event Macro for ObjectsMovedEvent
@@ -647,7 +758,7 @@ Remarks:
 // Enablement check macro for ObjectsSurvivedEvent
 //
 
-#define EventEnabledObjectsSurvivedEvent() ((ETWClrProfilerEnableBits[0] & 0x00000001) != 0)
+#define EventEnabledObjectsSurvivedEvent() ((ETWClrProfilerEnableBits[0] & 0x00000080) != 0)
 
 //
 // Event Macro for ObjectsSurvivedEvent
@@ -661,7 +772,7 @@ Remarks:
 // Enablement check macro for CaptureStateStart
 //
 
-#define EventEnabledCaptureStateStart() ((ETWClrProfilerEnableBits[0] & 0x00000020) != 0)
+#define EventEnabledCaptureStateStart() ((ETWClrProfilerEnableBits[0] & 0x00000100) != 0)
 
 //
 // Event Macro for CaptureStateStart
@@ -675,7 +786,7 @@ Remarks:
 // Enablement check macro for CaptureStateStop
 //
 
-#define EventEnabledCaptureStateStop() ((ETWClrProfilerEnableBits[0] & 0x00000020) != 0)
+#define EventEnabledCaptureStateStop() ((ETWClrProfilerEnableBits[0] & 0x00000100) != 0)
 
 //
 // Event Macro for CaptureStateStop
@@ -689,7 +800,7 @@ Remarks:
 // Enablement check macro for ProfilerError
 //
 
-#define EventEnabledProfilerError() ((ETWClrProfilerEnableBits[0] & 0x00000040) != 0)
+#define EventEnabledProfilerError() ((ETWClrProfilerEnableBits[0] & 0x00000200) != 0)
 
 //
 // Event Macro for ProfilerError
@@ -703,7 +814,7 @@ Remarks:
 // Enablement check macro for ProfilerShutdown
 //
 
-#define EventEnabledProfilerShutdown() ((ETWClrProfilerEnableBits[0] & 0x00000040) != 0)
+#define EventEnabledProfilerShutdown() ((ETWClrProfilerEnableBits[0] & 0x00000400) != 0)
 
 //
 // Event Macro for ProfilerShutdown
@@ -717,7 +828,7 @@ Remarks:
 // Enablement check macro for SamplingRateChange
 //
 
-#define EventEnabledSamplingRateChange() ((ETWClrProfilerEnableBits[0] & 0x00000080) != 0)
+#define EventEnabledSamplingRateChange() ((ETWClrProfilerEnableBits[0] & 0x00000800) != 0)
 
 //
 // Event Macro for SamplingRateChange
@@ -731,7 +842,7 @@ Remarks:
 // Enablement check macro for CallEnterEvent
 //
 
-#define EventEnabledCallEnterEvent() ((ETWClrProfilerEnableBits[0] & 0x00000100) != 0)
+#define EventEnabledCallEnterEvent() ((ETWClrProfilerEnableBits[0] & 0x00001000) != 0)
 
 //
 // Event Macro for CallEnterEvent
@@ -741,11 +852,431 @@ Remarks:
         McTemplateU0xq(&ETWClrProfiler_Context, &CallEnterEvent, FunctionID, SampleRate)\
         : ERROR_SUCCESS\
 
+//
+// Enablement check macro for GCFragmentationEvent
+//
+
+#define EventEnabledGCFragmentationEvent() ((ETWClrProfilerEnableBits[0] & 0x00002000) != 0)
+
+//
+// Event Macro for GCFragmentationEvent
+//
+#define EventWriteGCFragmentationEvent(GCID, Generation, RangeSize, LiveSize, FreeSize, LargestFreeBlock, BucketCount, GapCounts, GapSizes)\
+        MCGEN_EVENT_ENABLED(GCFragmentationEvent) ?\
+        McTemplateU0ddxxxxqQR6XR6(&ETWClrProfiler_Context, &GCFragmentationEvent, GCID, Generation, RangeSize, LiveSize, FreeSize, LargestFreeBlock, BucketCount, GapCounts, GapSizes)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for GCHandleSummaryEvent
+//
+
+#define EventEnabledGCHandleSummaryEvent() ((ETWClrProfilerEnableBits[0] & 0x00004000) != 0)
+
+//
+// Event Macro for GCHandleSummaryEvent
+//
+#define EventWriteGCHandleSummaryEvent(GCID, ClassID, HandleCount, AgeBucketCount, AgeCounts)\
+        MCGEN_EVENT_ENABLED(GCHandleSummaryEvent) ?\
+        McTemplateU0dxqqQR3(&ETWClrProfiler_Context, &GCHandleSummaryEvent, GCID, ClassID, HandleCount, AgeBucketCount, AgeCounts)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for FinalizerSummaryEvent
+//
+
+#define EventEnabledFinalizerSummaryEvent() ((ETWClrProfilerEnableBits[0] & 0x00008000) != 0)
+
+//
+// Event Macro for FinalizerSummaryEvent
+//
+#define EventWriteFinalizerSummaryEvent(GCID, Rank, ClassID, QueuedCount, TotalQueuedCount)\
+        MCGEN_EVENT_ENABLED(FinalizerSummaryEvent) ?\
+        McTemplateU0dqxqq(&ETWClrProfiler_Context, &FinalizerSummaryEvent, GCID, Rank, ClassID, QueuedCount, TotalQueuedCount)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for GCPromotionEvent
+//
+
+#define EventEnabledGCPromotionEvent() ((ETWClrProfilerEnableBits[0] & 0x00010000) != 0)
+
+//
+// Event Macro for GCPromotionEvent
+//
+#define EventWriteGCPromotionEvent(GCID, Generation, SampleRate, TotalCount, TotalSize, TypeCount, ClassIDs, ObjectCounts, ObjectSizes)\
+        MCGEN_EVENT_ENABLED(GCPromotionEvent) ?\
+        McTemplateU0ddqqxqXR5QR5XR5(&ETWClrProfiler_Context, &GCPromotionEvent, GCID, Generation, SampleRate, TotalCount, TotalSize, TypeCount, ClassIDs, ObjectCounts, ObjectSizes)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for DuplicateStringEvent
+//
+
+#define EventEnabledDuplicateStringEvent() ((ETWClrProfilerEnableBits[0] & 0x00020000) != 0)
+
+//
+// Event Macro for DuplicateStringEvent
+//
+#define EventWriteDuplicateStringEvent(GCID, Rank, Count, Length, WastedBytes, Value)\
+        MCGEN_EVENT_ENABLED(DuplicateStringEvent) ?\
+        McTemplateU0dqqqxz(&ETWClrProfiler_Context, &DuplicateStringEvent, GCID, Rank, Count, Length, WastedBytes, Value)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for ArrayWasteEvent
+//
+
+#define EventEnabledArrayWasteEvent() ((ETWClrProfilerEnableBits[0] & 0x00040000) != 0)
+
+//
+// Event Macro for ArrayWasteEvent
+//
+#define EventWriteArrayWasteEvent(GCID, ClassID, ArrayCount, SkippedCount, TotalBytes, ZeroBytes, TrailingZeroBytes)\
+        MCGEN_EVENT_ENABLED(ArrayWasteEvent) ?\
+        McTemplateU0dxqqxxx(&ETWClrProfiler_Context, &ArrayWasteEvent, GCID, ClassID, ArrayCount, SkippedCount, TotalBytes, ZeroBytes, TrailingZeroBytes)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for HeapSampleSummaryEvent
+//
+
+#define EventEnabledHeapSampleSummaryEvent() ((ETWClrProfilerEnableBits[0] & 0x00080000) != 0)
+
+//
+// Event Macro for HeapSampleSummaryEvent
+//
+#define EventWriteHeapSampleSummaryEvent(GCID, SampleRate, Count, ClassIDs, ObjectCounts, ObjectSizes)\
+        MCGEN_EVENT_ENABLED(HeapSampleSummaryEvent) ?\
+        McTemplateU0dqqXR2QR2XR2(&ETWClrProfiler_Context, &HeapSampleSummaryEvent, GCID, SampleRate, Count, ClassIDs, ObjectCounts, ObjectSizes)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for CallCountsEvent
+//
+
+#define EventEnabledCallCountsEvent() ((ETWClrProfilerEnableBits[0] & 0x00100000) != 0)
+
+//
+// Event Macro for CallCountsEvent
+//
+#define EventWriteCallCountsEvent(Count, FunctionIDs, CallCounts)\
+        MCGEN_EVENT_ENABLED(CallCountsEvent) ?\
+        McTemplateU0qXR0XR0(&ETWClrProfiler_Context, &CallCountsEvent, Count, FunctionIDs, CallCounts)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for CallTreeEvent
+//
+
+#define EventEnabledCallTreeEvent() ((ETWClrProfilerEnableBits[0] & 0x00200000) != 0)
+
+//
+// Event Macro for CallTreeEvent
+//
+#define EventWriteCallTreeEvent(FlushID, TicksPerSecond, Count, NodeIDs, ParentNodeIDs, FunctionIDs, CallCounts, InclusiveTicks, ExclusiveTicks)\
+        MCGEN_EVENT_ENABLED(CallTreeEvent) ?\
+        McTemplateU0qxqQR2QR2XR2XR2XR2XR2(&ETWClrProfiler_Context, &CallTreeEvent, FlushID, TicksPerSecond, Count, NodeIDs, ParentNodeIDs, FunctionIDs, CallCounts, InclusiveTicks, ExclusiveTicks)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for MethodLatencyEvent
+//
+
+#define EventEnabledMethodLatencyEvent() ((ETWClrProfilerEnableBits[0] & 0x00400000) != 0)
+
+//
+// Event Macro for MethodLatencyEvent
+//
+#define EventWriteMethodLatencyEvent(FunctionID, TicksPerSecond, SubBucketBits, Count, SumTicks, MaxTicks, BucketCount, BucketIndexes, BucketCounts, MethodName)\
+        MCGEN_EVENT_ENABLED(MethodLatencyEvent) ?\
+        McTemplateU0xxqxxxqHR6XR6z(&ETWClrProfiler_Context, &MethodLatencyEvent, FunctionID, TicksPerSecond, SubBucketBits, Count, SumTicks, MaxTicks, BucketCount, BucketIndexes, BucketCounts, MethodName)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for CallEdgesEvent
+//
+
+#define EventEnabledCallEdgesEvent() ((ETWClrProfilerEnableBits[0] & 0x00800000) != 0)
+
+//
+// Event Macro for CallEdgesEvent
+//
+#define EventWriteCallEdgesEvent(SamplingRate, Count, CallerIDs, CalleeIDs, SampleCounts)\
+        MCGEN_EVENT_ENABLED(CallEdgesEvent) ?\
+        McTemplateU0qqXR1XR1XR1(&ETWClrProfiler_Context, &CallEdgesEvent, SamplingRate, Count, CallerIDs, CalleeIDs, SampleCounts)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for CallScopeStartEvent
+//
+
+#define EventEnabledCallScopeStartEvent() ((ETWClrProfilerEnableBits[0] & 0x01000000) != 0)
+
+//
+// Event Macro for CallScopeStartEvent
+//
+#define EventWriteCallScopeStartEvent(FunctionID)\
+        MCGEN_EVENT_ENABLED(CallScopeStartEvent) ?\
+        McTemplateU0x(&ETWClrProfiler_Context, &CallScopeStartEvent, FunctionID)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for CallScopeStopEvent
+//
+
+#define EventEnabledCallScopeStopEvent() ((ETWClrProfilerEnableBits[0] & 0x01000000) != 0)
+
+//
+// Event Macro for CallScopeStopEvent
+//
+#define EventWriteCallScopeStopEvent(FunctionID)\
+        MCGEN_EVENT_ENABLED(CallScopeStopEvent) ?\
+        McTemplateU0x(&ETWClrProfiler_Context, &CallScopeStopEvent, FunctionID)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for FunctionIDDefinitionEvent
+//
+
+#define EventEnabledFunctionIDDefinitionEvent() ((ETWClrProfilerEnableBits[0] & 0x02000000) != 0)
+
+//
+// Event Macro for FunctionIDDefinitionEvent
+//
+#define EventWriteFunctionIDDefinitionEvent(FunctionID, Token, ClassID, ModuleID, Name)\
+        MCGEN_EVENT_ENABLED(FunctionIDDefinitionEvent) ?\
+        McTemplateU0xqxxz(&ETWClrProfiler_Context, &FunctionIDDefinitionEvent, FunctionID, Token, ClassID, ModuleID, Name)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for StackDefinitionEvent
+//
+
+#define EventEnabledStackDefinitionEvent() ((ETWClrProfilerEnableBits[0] & 0x04000000) != 0)
+
+//
+// Event Macro for StackDefinitionEvent
+//
+#define EventWriteStackDefinitionEvent(StackID, Count, FunctionIDs)\
+        MCGEN_EVENT_ENABLED(StackDefinitionEvent) ?\
+        McTemplateU0qqXR1(&ETWClrProfiler_Context, &StackDefinitionEvent, StackID, Count, FunctionIDs)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for CallStackSampleEvent
+//
+
+#define EventEnabledCallStackSampleEvent() ((ETWClrProfilerEnableBits[0] & 0x08000000) != 0)
+
+//
+// Event Macro for CallStackSampleEvent
+//
+#define EventWriteCallStackSampleEvent(FunctionID, SamplingRate, StackID)\
+        MCGEN_EVENT_ENABLED(CallStackSampleEvent) ?\
+        McTemplateU0xqq(&ETWClrProfiler_Context, &CallStackSampleEvent, FunctionID, SamplingRate, StackID)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for CpuSampleCountsEvent
+//
+
+#define EventEnabledCpuSampleCountsEvent() ((ETWClrProfilerEnableBits[0] & 0x10000000) != 0)
+
+//
+// Event Macro for CpuSampleCountsEvent
+//
+#define EventWriteCpuSampleCountsEvent(SampleIntervalMSec, Count, StackIDs, SampleCounts)\
+        MCGEN_EVENT_ENABLED(CpuSampleCountsEvent) ?\
+        McTemplateU0qqQR1QR1(&ETWClrProfiler_Context, &CpuSampleCountsEvent, SampleIntervalMSec, Count, StackIDs, SampleCounts)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for JitMethodTimesEvent
+//
+
+#define EventEnabledJitMethodTimesEvent() ((ETWClrProfilerEnableBits[0] & 0x20000000) != 0)
+
+//
+// Event Macro for JitMethodTimesEvent
+//
+#define EventWriteJitMethodTimesEvent(TicksPerSecond, Count, FunctionIDs, JitCounts, JitTicks)\
+        MCGEN_EVENT_ENABLED(JitMethodTimesEvent) ?\
+        McTemplateU0xqXR1QR1XR1(&ETWClrProfiler_Context, &JitMethodTimesEvent, TicksPerSecond, Count, FunctionIDs, JitCounts, JitTicks)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for JitModuleTimesEvent
+//
+
+#define EventEnabledJitModuleTimesEvent() ((ETWClrProfilerEnableBits[0] & 0x20000000) != 0)
+
+//
+// Event Macro for JitModuleTimesEvent
+//
+#define EventWriteJitModuleTimesEvent(TicksPerSecond, Count, ModuleIDs, JitCounts, JitTicks)\
+        MCGEN_EVENT_ENABLED(JitModuleTimesEvent) ?\
+        McTemplateU0xqXR1QR1XR1(&ETWClrProfiler_Context, &JitModuleTimesEvent, TicksPerSecond, Count, ModuleIDs, JitCounts, JitTicks)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for JitTimeHistogramEvent
+//
+
+#define EventEnabledJitTimeHistogramEvent() ((ETWClrProfilerEnableBits[0] & 0x20000000) != 0)
+
+//
+// Event Macro for JitTimeHistogramEvent
+//
+#define EventWriteJitTimeHistogramEvent(TicksPerSecond, SubBucketBits, Count, SumTicks, MaxTicks, BucketCount, BucketIndexes, BucketCounts)\
+        MCGEN_EVENT_ENABLED(JitTimeHistogramEvent) ?\
+        McTemplateU0xqxxxqHR5XR5(&ETWClrProfiler_Context, &JitTimeHistogramEvent, TicksPerSecond, SubBucketBits, Count, SumTicks, MaxTicks, BucketCount, BucketIndexes, BucketCounts)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for PerfMapEvent
+//
+
+#define EventEnabledPerfMapEvent() ((ETWClrProfilerEnableBits[0] & 0x40000000) != 0)
+
+//
+// Event Macro for PerfMapEvent
+//
+#define EventWritePerfMapEvent(FilePath, MethodCount)\
+        MCGEN_EVENT_ENABLED(PerfMapEvent) ?\
+        McTemplateU0zq(&ETWClrProfiler_Context, &PerfMapEvent, FilePath, MethodCount)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for JitInlineCountsEvent
+//
+
+#define EventEnabledJitInlineCountsEvent() ((ETWClrProfilerEnableBits[0] & 0x80000000) != 0)
+
+//
+// Event Macro for JitInlineCountsEvent
+//
+#define EventWriteJitInlineCountsEvent(Count, FunctionIDs, InlineCounts, CallerCounts)\
+        MCGEN_EVENT_ENABLED(JitInlineCountsEvent) ?\
+        McTemplateU0qXR0XR0QR0(&ETWClrProfiler_Context, &JitInlineCountsEvent, Count, FunctionIDs, InlineCounts, CallerCounts)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for StartupTimelineEvent
+//
+
+#define EventEnabledStartupTimelineEvent() ((ETWClrProfilerEnableBits[1] & 0x00000001) != 0)
+
+//
+// Event Macro for StartupTimelineEvent
+//
+#define EventWriteStartupTimelineEvent(ThreadID, TicksPerSecond, Count, Kinds, IDs, StartTicks, DurationTicks)\
+        MCGEN_EVENT_ENABLED(StartupTimelineEvent) ?\
+        McTemplateU0qxqCR2XR2XR2XR2(&ETWClrProfiler_Context, &StartupTimelineEvent, ThreadID, TicksPerSecond, Count, Kinds, IDs, StartTicks, DurationTicks)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for StartupAssemblyCostsEvent
+//
+
+#define EventEnabledStartupAssemblyCostsEvent() ((ETWClrProfilerEnableBits[1] & 0x00000001) != 0)
+
+//
+// Event Macro for StartupAssemblyCostsEvent
+//
+#define EventWriteStartupAssemblyCostsEvent(TicksPerSecond, Count, AssemblyIDs, AssemblyLoadTicks, ModuleLoadTicks, ClassLoadTicks, JitTicks, ClassLoadCounts, JitCounts)\
+        MCGEN_EVENT_ENABLED(StartupAssemblyCostsEvent) ?\
+        McTemplateU0xqXR1XR1XR1XR1XR1QR1QR1(&ETWClrProfiler_Context, &StartupAssemblyCostsEvent, TicksPerSecond, Count, AssemblyIDs, AssemblyLoadTicks, ModuleLoadTicks, ClassLoadTicks, JitTicks, ClassLoadCounts, JitCounts)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for GCPauseEvent
+//
+
+#define EventEnabledGCPauseEvent() ((ETWClrProfilerEnableBits[1] & 0x00000002) != 0)
+
+//
+// Event Macro for GCPauseEvent
+//
+#define EventWriteGCPauseEvent(TicksPerSecond, GCID, SuspendReason, SuspendTicks, GCTicks, ResumeTicks, PauseTicks)\
+        MCGEN_EVENT_ENABLED(GCPauseEvent) ?\
+        McTemplateU0xdqxxxx(&ETWClrProfiler_Context, &GCPauseEvent, TicksPerSecond, GCID, SuspendReason, SuspendTicks, GCTicks, ResumeTicks, PauseTicks)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for GCPauseHistogramEvent
+//
+
+#define EventEnabledGCPauseHistogramEvent() ((ETWClrProfilerEnableBits[1] & 0x00000002) != 0)
+
+//
+// Event Macro for GCPauseHistogramEvent
+//
+#define EventWriteGCPauseHistogramEvent(TicksPerSecond, SuspendReason, Phase, SubBucketBits, Count, SumTicks, MaxTicks, BucketCount, BucketIndexes, BucketCounts)\
+        MCGEN_EVENT_ENABLED(GCPauseHistogramEvent) ?\
+        McTemplateU0xqqqxxxqHR7XR7(&ETWClrProfiler_Context, &GCPauseHistogramEvent, TicksPerSecond, SuspendReason, Phase, SubBucketBits, Count, SumTicks, MaxTicks, BucketCount, BucketIndexes, BucketCounts)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for SafePointLaggardsEvent
+//
+
+#define EventEnabledSafePointLaggardsEvent() ((ETWClrProfilerEnableBits[1] & 0x00000004) != 0)
+
+//
+// Event Macro for SafePointLaggardsEvent
+//
+#define EventWriteSafePointLaggardsEvent(TicksPerSecond, SuspendReason, SuspendTicks, ThreadCount, Count, ThreadIDs, OSThreadIDs, Ticks, StackIDs)\
+        MCGEN_EVENT_ENABLED(SafePointLaggardsEvent) ?\
+        McTemplateU0xqxqqXR4QR4XR4QR4(&ETWClrProfiler_Context, &SafePointLaggardsEvent, TicksPerSecond, SuspendReason, SuspendTicks, ThreadCount, Count, ThreadIDs, OSThreadIDs, Ticks, StackIDs)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for ExceptionCountsEvent
+//
+
+#define EventEnabledExceptionCountsEvent() ((ETWClrProfilerEnableBits[1] & 0x00000008) != 0)
+
+//
+// Event Macro for ExceptionCountsEvent
+//
+#define EventWriteExceptionCountsEvent(TicksPerSecond, Count, ClassIDs, ThrowCounts, SearchTicks, UnwindTicks)\
+        MCGEN_EVENT_ENABLED(ExceptionCountsEvent) ?\
+        McTemplateU0xqXR1QR1XR1XR1(&ETWClrProfiler_Context, &ExceptionCountsEvent, TicksPerSecond, Count, ClassIDs, ThrowCounts, SearchTicks, UnwindTicks)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for ExceptionStacksEvent
+//
+
+#define EventEnabledExceptionStacksEvent() ((ETWClrProfilerEnableBits[1] & 0x00000008) != 0)
+
+//
+// Event Macro for ExceptionStacksEvent
+//
+#define EventWriteExceptionStacksEvent(SamplingRate, Count, ClassIDs, StackIDs, SampleCounts)\
+        MCGEN_EVENT_ENABLED(ExceptionStacksEvent) ?\
+        McTemplateU0qqXR1QR1QR1(&ETWClrProfiler_Context, &ExceptionStacksEvent, SamplingRate, Count, ClassIDs, StackIDs, SampleCounts)\
+        : ERROR_SUCCESS\
+
+//
+// Enablement check macro for TransitionCountsEvent
+//
+
+#define EventEnabledTransitionCountsEvent() ((ETWClrProfilerEnableBits[1] & 0x00000010) != 0)
+
+//
+// Event Macro for TransitionCountsEvent
+//
+#define EventWriteTransitionCountsEvent(TicksPerSecond, Count, FunctionIDs, Kinds, Counts, NativeTicks)\
+        MCGEN_EVENT_ENABLED(TransitionCountsEvent) ?\
+        McTemplateU0xqXR1CR1XR1XR1(&ETWClrProfiler_Context, &TransitionCountsEvent, TicksPerSecond, Count, FunctionIDs, Kinds, Counts, NativeTicks)\
+        : ERROR_SUCCESS\
+
 //
 // Enablement check macro for SendManifestEvent
 //
 
-#define EventEnabledSendManifestEvent() ((ETWClrProfilerEnableBits[0] & 0x00000200) != 0)
+#define EventEnabledSendManifestEvent() ((ETWClrProfilerEnableBits[1] & 0x00000020) != 0)
 
 //
 // Event Macro for SendManifestEvent
@@ -1215,6 +1746,1055 @@ McTemplateU0xq(
 }
 #endif
 
+//
+//Template from manifest : GCFragmentationArgs
+//
+#ifndef McTemplateU0ddxxxxqQR6XR6_def
+#define McTemplateU0ddxxxxqQR6XR6_def
+ETW_INLINE
+ULONG
+McTemplateU0ddxxxxqQR6XR6(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const signed int  _Arg0,
+    _In_ const signed int  _Arg1,
+    _In_ unsigned __int64  _Arg2,
+    _In_ unsigned __int64  _Arg3,
+    _In_ unsigned __int64  _Arg4,
+    _In_ unsigned __int64  _Arg5,
+    _In_ const unsigned int  _Arg6,
+    _In_reads_(_Arg6) const unsigned int *_Arg7,
+    _In_reads_(_Arg6) const unsigned __int64 *_Arg8
+    )
+{
+#define McTemplateU0ddxxxxqQR6XR6_ARGCOUNT 9
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0ddxxxxqQR6XR6_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const signed int)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const signed int)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[4],&_Arg3, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[5],&_Arg4, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[6],&_Arg5, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[7],&_Arg6, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[8], _Arg7, sizeof(const unsigned int)*_Arg6);
+
+    EventDataDescCreate(&EventData[9], _Arg8, sizeof(unsigned __int64)*_Arg6);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0ddxxxxqQR6XR6_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : GCHandleSummaryArgs
+//
+#ifndef McTemplateU0dxqqQR3_def
+#define McTemplateU0dxqqQR3_def
+ETW_INLINE
+ULONG
+McTemplateU0dxqqQR3(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const signed int  _Arg0,
+    _In_ unsigned __int64  _Arg1,
+    _In_ const unsigned int  _Arg2,
+    _In_ const unsigned int  _Arg3,
+    _In_reads_(_Arg3) const unsigned int *_Arg4
+    )
+{
+#define McTemplateU0dxqqQR3_ARGCOUNT 5
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0dxqqQR3_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const signed int)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[4],&_Arg3, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[5], _Arg4, sizeof(const unsigned int)*_Arg3);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0dxqqQR3_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : FinalizerSummaryArgs
+//
+#ifndef McTemplateU0dqxqq_def
+#define McTemplateU0dqxqq_def
+ETW_INLINE
+ULONG
+McTemplateU0dqxqq(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const signed int  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_ unsigned __int64  _Arg2,
+    _In_ const unsigned int  _Arg3,
+    _In_ const unsigned int  _Arg4
+    )
+{
+#define McTemplateU0dqxqq_ARGCOUNT 5
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0dqxqq_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const signed int)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[4],&_Arg3, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[5],&_Arg4, sizeof(const unsigned int)  );
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0dqxqq_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : GCPromotionArgs
+//
+#ifndef McTemplateU0ddqqxqXR5QR5XR5_def
+#define McTemplateU0ddqqxqXR5QR5XR5_def
+ETW_INLINE
+ULONG
+McTemplateU0ddqqxqXR5QR5XR5(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const signed int  _Arg0,
+    _In_ const signed int  _Arg1,
+    _In_ const unsigned int  _Arg2,
+    _In_ const unsigned int  _Arg3,
+    _In_ unsigned __int64  _Arg4,
+    _In_ const unsigned int  _Arg5,
+    _In_reads_(_Arg5) const unsigned __int64 *_Arg6,
+    _In_reads_(_Arg5) const unsigned int *_Arg7,
+    _In_reads_(_Arg5) const unsigned __int64 *_Arg8
+    )
+{
+#define McTemplateU0ddqqxqXR5QR5XR5_ARGCOUNT 9
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0ddqqxqXR5QR5XR5_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const signed int)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const signed int)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[4],&_Arg3, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[5],&_Arg4, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[6],&_Arg5, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[7], _Arg6, sizeof(unsigned __int64)*_Arg5);
+
+    EventDataDescCreate(&EventData[8], _Arg7, sizeof(const unsigned int)*_Arg5);
+
+    EventDataDescCreate(&EventData[9], _Arg8, sizeof(unsigned __int64)*_Arg5);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0ddqqxqXR5QR5XR5_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : DuplicateStringArgs
+//
+#ifndef McTemplateU0dqqqxz_def
+#define McTemplateU0dqqqxz_def
+ETW_INLINE
+ULONG
+McTemplateU0dqqqxz(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const signed int  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_ const unsigned int  _Arg2,
+    _In_ const unsigned int  _Arg3,
+    _In_ unsigned __int64  _Arg4,
+    _In_opt_ PCWSTR  _Arg5
+    )
+{
+#define McTemplateU0dqqqxz_ARGCOUNT 6
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0dqqqxz_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const signed int)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[4],&_Arg3, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[5],&_Arg4, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[6],
+                        (_Arg5 != NULL) ? _Arg5 : L"NULL",
+                        (_Arg5 != NULL) ? (ULONG)((wcslen(_Arg5) + 1) * sizeof(WCHAR)) : (ULONG)sizeof(L"NULL"));
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0dqqqxz_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : ArrayWasteArgs
+//
+#ifndef McTemplateU0dxqqxxx_def
+#define McTemplateU0dxqqxxx_def
+ETW_INLINE
+ULONG
+McTemplateU0dxqqxxx(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const signed int  _Arg0,
+    _In_ unsigned __int64  _Arg1,
+    _In_ const unsigned int  _Arg2,
+    _In_ const unsigned int  _Arg3,
+    _In_ unsigned __int64  _Arg4,
+    _In_ unsigned __int64  _Arg5,
+    _In_ unsigned __int64  _Arg6
+    )
+{
+#define McTemplateU0dxqqxxx_ARGCOUNT 7
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0dxqqxxx_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const signed int)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[4],&_Arg3, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[5],&_Arg4, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[6],&_Arg5, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[7],&_Arg6, sizeof(unsigned __int64)  );
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0dxqqxxx_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : HeapSampleSummaryArgs
+//
+#ifndef McTemplateU0dqqXR2QR2XR2_def
+#define McTemplateU0dqqXR2QR2XR2_def
+ETW_INLINE
+ULONG
+McTemplateU0dqqXR2QR2XR2(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const signed int  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_ const unsigned int  _Arg2,
+    _In_reads_(_Arg2) const unsigned __int64 *_Arg3,
+    _In_reads_(_Arg2) const unsigned int *_Arg4,
+    _In_reads_(_Arg2) const unsigned __int64 *_Arg5
+    )
+{
+#define McTemplateU0dqqXR2QR2XR2_ARGCOUNT 6
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0dqqXR2QR2XR2_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const signed int)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[4], _Arg3, sizeof(unsigned __int64)*_Arg2);
+
+    EventDataDescCreate(&EventData[5], _Arg4, sizeof(const unsigned int)*_Arg2);
+
+    EventDataDescCreate(&EventData[6], _Arg5, sizeof(unsigned __int64)*_Arg2);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0dqqXR2QR2XR2_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : CallCountsArgs
+//
+#ifndef McTemplateU0qXR0XR0_def
+#define McTemplateU0qXR0XR0_def
+ETW_INLINE
+ULONG
+McTemplateU0qXR0XR0(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const unsigned int  _Arg0,
+    _In_reads_(_Arg0) const unsigned __int64 *_Arg1,
+    _In_reads_(_Arg0) const unsigned __int64 *_Arg2
+    )
+{
+#define McTemplateU0qXR0XR0_ARGCOUNT 3
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0qXR0XR0_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[2], _Arg1, sizeof(unsigned __int64)*_Arg0);
+
+    EventDataDescCreate(&EventData[3], _Arg2, sizeof(unsigned __int64)*_Arg0);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0qXR0XR0_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : CallTreeArgs
+//
+#ifndef McTemplateU0qxqQR2QR2XR2XR2XR2XR2_def
+#define McTemplateU0qxqQR2QR2XR2XR2XR2XR2_def
+ETW_INLINE
+ULONG
+McTemplateU0qxqQR2QR2XR2XR2XR2XR2(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const unsigned int  _Arg0,
+    _In_ unsigned __int64  _Arg1,
+    _In_ const unsigned int  _Arg2,
+    _In_reads_(_Arg2) const unsigned int *_Arg3,
+    _In_reads_(_Arg2) const unsigned int *_Arg4,
+    _In_reads_(_Arg2) const unsigned __int64 *_Arg5,
+    _In_reads_(_Arg2) const unsigned __int64 *_Arg6,
+    _In_reads_(_Arg2) const unsigned __int64 *_Arg7,
+    _In_reads_(_Arg2) const unsigned __int64 *_Arg8
+    )
+{
+#define McTemplateU0qxqQR2QR2XR2XR2XR2XR2_ARGCOUNT 9
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0qxqQR2QR2XR2XR2XR2XR2_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[4], _Arg3, sizeof(const unsigned int)*_Arg2);
+
+    EventDataDescCreate(&EventData[5], _Arg4, sizeof(const unsigned int)*_Arg2);
+
+    EventDataDescCreate(&EventData[6], _Arg5, sizeof(unsigned __int64)*_Arg2);
+
+    EventDataDescCreate(&EventData[7], _Arg6, sizeof(unsigned __int64)*_Arg2);
+
+    EventDataDescCreate(&EventData[8], _Arg7, sizeof(unsigned __int64)*_Arg2);
+
+    EventDataDescCreate(&EventData[9], _Arg8, sizeof(unsigned __int64)*_Arg2);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0qxqQR2QR2XR2XR2XR2XR2_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : MethodLatencyArgs
+//
+#ifndef McTemplateU0xxqxxxqHR6XR6z_def
+#define McTemplateU0xxqxxxqHR6XR6z_def
+ETW_INLINE
+ULONG
+McTemplateU0xxqxxxqHR6XR6z(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ unsigned __int64  _Arg0,
+    _In_ unsigned __int64  _Arg1,
+    _In_ const unsigned int  _Arg2,
+    _In_ unsigned __int64  _Arg3,
+    _In_ unsigned __int64  _Arg4,
+    _In_ unsigned __int64  _Arg5,
+    _In_ const unsigned int  _Arg6,
+    _In_reads_(_Arg6) const unsigned short *_Arg7,
+    _In_reads_(_Arg6) const unsigned __int64 *_Arg8,
+    _In_opt_ PCWSTR  _Arg9
+    )
+{
+#define McTemplateU0xxqxxxqHR6XR6z_ARGCOUNT 10
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0xxqxxxqHR6XR6z_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[4],&_Arg3, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[5],&_Arg4, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[6],&_Arg5, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[7],&_Arg6, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[8], _Arg7, sizeof(const unsigned short)*_Arg6);
+
+    EventDataDescCreate(&EventData[9], _Arg8, sizeof(unsigned __int64)*_Arg6);
+
+    EventDataDescCreate(&EventData[10],
+                        (_Arg9 != NULL) ? _Arg9 : L"NULL",
+                        (_Arg9 != NULL) ? (ULONG)((wcslen(_Arg9) + 1) * sizeof(WCHAR)) : (ULONG)sizeof(L"NULL"));
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0xxqxxxqHR6XR6z_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : CallEdgesArgs
+//
+#ifndef McTemplateU0qqXR1XR1XR1_def
+#define McTemplateU0qqXR1XR1XR1_def
+ETW_INLINE
+ULONG
+McTemplateU0qqXR1XR1XR1(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const unsigned int  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg2,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg3,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg4
+    )
+{
+#define McTemplateU0qqXR1XR1XR1_ARGCOUNT 5
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0qqXR1XR1XR1_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3], _Arg2, sizeof(unsigned __int64)*_Arg1);
+
+    EventDataDescCreate(&EventData[4], _Arg3, sizeof(unsigned __int64)*_Arg1);
+
+    EventDataDescCreate(&EventData[5], _Arg4, sizeof(unsigned __int64)*_Arg1);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0qqXR1XR1XR1_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : FunctionIDDefinitionArgs
+//
+#ifndef McTemplateU0xqxxz_def
+#define McTemplateU0xqxxz_def
+ETW_INLINE
+ULONG
+McTemplateU0xqxxz(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ unsigned __int64  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_ unsigned __int64  _Arg2,
+    _In_ unsigned __int64  _Arg3,
+    _In_opt_ PCWSTR  _Arg4
+    )
+{
+#define McTemplateU0xqxxz_ARGCOUNT 5
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0xqxxz_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[4],&_Arg3, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[5],
+                        (_Arg4 != NULL) ? _Arg4 : L"NULL",
+                        (_Arg4 != NULL) ? (ULONG)((wcslen(_Arg4) + 1) * sizeof(WCHAR)) : (ULONG)sizeof(L"NULL"));
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0xqxxz_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : StackDefinitionArgs
+//
+#ifndef McTemplateU0qqXR1_def
+#define McTemplateU0qqXR1_def
+ETW_INLINE
+ULONG
+McTemplateU0qqXR1(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const unsigned int  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg2
+    )
+{
+#define McTemplateU0qqXR1_ARGCOUNT 3
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0qqXR1_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3], _Arg2, sizeof(unsigned __int64)*_Arg1);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0qqXR1_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : CallStackSampleArgs
+//
+#ifndef McTemplateU0xqq_def
+#define McTemplateU0xqq_def
+ETW_INLINE
+ULONG
+McTemplateU0xqq(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ unsigned __int64  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_ const unsigned int  _Arg2
+    )
+{
+#define McTemplateU0xqq_ARGCOUNT 3
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0xqq_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(const unsigned int)  );
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0xqq_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : CpuSampleCountsArgs
+//
+#ifndef McTemplateU0qqQR1QR1_def
+#define McTemplateU0qqQR1QR1_def
+ETW_INLINE
+ULONG
+McTemplateU0qqQR1QR1(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const unsigned int  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_reads_(_Arg1) const unsigned int *_Arg2,
+    _In_reads_(_Arg1) const unsigned int *_Arg3
+    )
+{
+#define McTemplateU0qqQR1QR1_ARGCOUNT 4
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0qqQR1QR1_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3], _Arg2, sizeof(const unsigned int)*_Arg1);
+
+    EventDataDescCreate(&EventData[4], _Arg3, sizeof(const unsigned int)*_Arg1);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0qqQR1QR1_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : JitMethodTimesArgs
+//
+#ifndef McTemplateU0xqXR1QR1XR1_def
+#define McTemplateU0xqXR1QR1XR1_def
+ETW_INLINE
+ULONG
+McTemplateU0xqXR1QR1XR1(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ unsigned __int64  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg2,
+    _In_reads_(_Arg1) const unsigned int *_Arg3,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg4
+    )
+{
+#define McTemplateU0xqXR1QR1XR1_ARGCOUNT 5
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0xqXR1QR1XR1_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3], _Arg2, sizeof(unsigned __int64)*_Arg1);
+
+    EventDataDescCreate(&EventData[4], _Arg3, sizeof(const unsigned int)*_Arg1);
+
+    EventDataDescCreate(&EventData[5], _Arg4, sizeof(unsigned __int64)*_Arg1);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0xqXR1QR1XR1_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : JitTimeHistogramArgs
+//
+#ifndef McTemplateU0xqxxxqHR5XR5_def
+#define McTemplateU0xqxxxqHR5XR5_def
+ETW_INLINE
+ULONG
+McTemplateU0xqxxxqHR5XR5(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ unsigned __int64  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_ unsigned __int64  _Arg2,
+    _In_ unsigned __int64  _Arg3,
+    _In_ unsigned __int64  _Arg4,
+    _In_ const unsigned int  _Arg5,
+    _In_reads_(_Arg5) const unsigned short *_Arg6,
+    _In_reads_(_Arg5) const unsigned __int64 *_Arg7
+    )
+{
+#define McTemplateU0xqxxxqHR5XR5_ARGCOUNT 8
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0xqxxxqHR5XR5_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[4],&_Arg3, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[5],&_Arg4, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[6],&_Arg5, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[7], _Arg6, sizeof(const unsigned short)*_Arg5);
+
+    EventDataDescCreate(&EventData[8], _Arg7, sizeof(unsigned __int64)*_Arg5);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0xqxxxqHR5XR5_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : PerfMapArgs
+//
+#ifndef McTemplateU0zq_def
+#define McTemplateU0zq_def
+ETW_INLINE
+ULONG
+McTemplateU0zq(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_opt_ PCWSTR  _Arg0,
+    _In_ const unsigned int  _Arg1
+    )
+{
+#define McTemplateU0zq_ARGCOUNT 2
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0zq_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],
+                        (_Arg0 != NULL) ? _Arg0 : L"NULL",
+                        (_Arg0 != NULL) ? (ULONG)((wcslen(_Arg0) + 1) * sizeof(WCHAR)) : (ULONG)sizeof(L"NULL"));
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0zq_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : JitInlineCountsArgs
+//
+#ifndef McTemplateU0qXR0XR0QR0_def
+#define McTemplateU0qXR0XR0QR0_def
+ETW_INLINE
+ULONG
+McTemplateU0qXR0XR0QR0(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const unsigned int  _Arg0,
+    _In_reads_(_Arg0) const unsigned __int64 *_Arg1,
+    _In_reads_(_Arg0) const unsigned __int64 *_Arg2,
+    _In_reads_(_Arg0) const unsigned int *_Arg3
+    )
+{
+#define McTemplateU0qXR0XR0QR0_ARGCOUNT 4
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0qXR0XR0QR0_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[2], _Arg1, sizeof(unsigned __int64)*_Arg0);
+
+    EventDataDescCreate(&EventData[3], _Arg2, sizeof(unsigned __int64)*_Arg0);
+
+    EventDataDescCreate(&EventData[4], _Arg3, sizeof(const unsigned int)*_Arg0);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0qXR0XR0QR0_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : StartupTimelineArgs
+//
+#ifndef McTemplateU0qxqCR2XR2XR2XR2_def
+#define McTemplateU0qxqCR2XR2XR2XR2_def
+ETW_INLINE
+ULONG
+McTemplateU0qxqCR2XR2XR2XR2(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const unsigned int  _Arg0,
+    _In_ unsigned __int64  _Arg1,
+    _In_ const unsigned int  _Arg2,
+    _In_reads_(_Arg2) const UCHAR *_Arg3,
+    _In_reads_(_Arg2) const unsigned __int64 *_Arg4,
+    _In_reads_(_Arg2) const unsigned __int64 *_Arg5,
+    _In_reads_(_Arg2) const unsigned __int64 *_Arg6
+    )
+{
+#define McTemplateU0qxqCR2XR2XR2XR2_ARGCOUNT 7
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0qxqCR2XR2XR2XR2_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[4], _Arg3, sizeof(const UCHAR)*_Arg2);
+
+    EventDataDescCreate(&EventData[5], _Arg4, sizeof(unsigned __int64)*_Arg2);
+
+    EventDataDescCreate(&EventData[6], _Arg5, sizeof(unsigned __int64)*_Arg2);
+
+    EventDataDescCreate(&EventData[7], _Arg6, sizeof(unsigned __int64)*_Arg2);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0qxqCR2XR2XR2XR2_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : StartupAssemblyCostsArgs
+//
+#ifndef McTemplateU0xqXR1XR1XR1XR1XR1QR1QR1_def
+#define McTemplateU0xqXR1XR1XR1XR1XR1QR1QR1_def
+ETW_INLINE
+ULONG
+McTemplateU0xqXR1XR1XR1XR1XR1QR1QR1(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ unsigned __int64  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg2,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg3,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg4,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg5,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg6,
+    _In_reads_(_Arg1) const unsigned int *_Arg7,
+    _In_reads_(_Arg1) const unsigned int *_Arg8
+    )
+{
+#define McTemplateU0xqXR1XR1XR1XR1XR1QR1QR1_ARGCOUNT 9
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0xqXR1XR1XR1XR1XR1QR1QR1_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3], _Arg2, sizeof(unsigned __int64)*_Arg1);
+
+    EventDataDescCreate(&EventData[4], _Arg3, sizeof(unsigned __int64)*_Arg1);
+
+    EventDataDescCreate(&EventData[5], _Arg4, sizeof(unsigned __int64)*_Arg1);
+
+    EventDataDescCreate(&EventData[6], _Arg5, sizeof(unsigned __int64)*_Arg1);
+
+    EventDataDescCreate(&EventData[7], _Arg6, sizeof(unsigned __int64)*_Arg1);
+
+    EventDataDescCreate(&EventData[8], _Arg7, sizeof(const unsigned int)*_Arg1);
+
+    EventDataDescCreate(&EventData[9], _Arg8, sizeof(const unsigned int)*_Arg1);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0xqXR1XR1XR1XR1XR1QR1QR1_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : GCPauseArgs
+//
+#ifndef McTemplateU0xdqxxxx_def
+#define McTemplateU0xdqxxxx_def
+ETW_INLINE
+ULONG
+McTemplateU0xdqxxxx(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ unsigned __int64  _Arg0,
+    _In_ const signed int  _Arg1,
+    _In_ const unsigned int  _Arg2,
+    _In_ unsigned __int64  _Arg3,
+    _In_ unsigned __int64  _Arg4,
+    _In_ unsigned __int64  _Arg5,
+    _In_ unsigned __int64  _Arg6
+    )
+{
+#define McTemplateU0xdqxxxx_ARGCOUNT 7
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0xdqxxxx_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const signed int)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[4],&_Arg3, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[5],&_Arg4, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[6],&_Arg5, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[7],&_Arg6, sizeof(unsigned __int64)  );
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0xdqxxxx_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : GCPauseHistogramArgs
+//
+#ifndef McTemplateU0xqqqxxxqHR7XR7_def
+#define McTemplateU0xqqqxxxqHR7XR7_def
+ETW_INLINE
+ULONG
+McTemplateU0xqqqxxxqHR7XR7(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ unsigned __int64  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_ const unsigned int  _Arg2,
+    _In_ const unsigned int  _Arg3,
+    _In_ unsigned __int64  _Arg4,
+    _In_ unsigned __int64  _Arg5,
+    _In_ unsigned __int64  _Arg6,
+    _In_ const unsigned int  _Arg7,
+    _In_reads_(_Arg7) const unsigned short *_Arg8,
+    _In_reads_(_Arg7) const unsigned __int64 *_Arg9
+    )
+{
+#define McTemplateU0xqqqxxxqHR7XR7_ARGCOUNT 10
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0xqqqxxxqHR7XR7_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[4],&_Arg3, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[5],&_Arg4, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[6],&_Arg5, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[7],&_Arg6, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[8],&_Arg7, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[9], _Arg8, sizeof(const unsigned short)*_Arg7);
+
+    EventDataDescCreate(&EventData[10], _Arg9, sizeof(unsigned __int64)*_Arg7);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0xqqqxxxqHR7XR7_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : SafePointLaggardsArgs
+//
+#ifndef McTemplateU0xqxqqXR4QR4XR4QR4_def
+#define McTemplateU0xqxqqXR4QR4XR4QR4_def
+ETW_INLINE
+ULONG
+McTemplateU0xqxqqXR4QR4XR4QR4(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ unsigned __int64  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_ unsigned __int64  _Arg2,
+    _In_ const unsigned int  _Arg3,
+    _In_ const unsigned int  _Arg4,
+    _In_reads_(_Arg4) const unsigned __int64 *_Arg5,
+    _In_reads_(_Arg4) const unsigned int *_Arg6,
+    _In_reads_(_Arg4) const unsigned __int64 *_Arg7,
+    _In_reads_(_Arg4) const unsigned int *_Arg8
+    )
+{
+#define McTemplateU0xqxqqXR4QR4XR4QR4_ARGCOUNT 9
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0xqxqqXR4QR4XR4QR4_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3],&_Arg2, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[4],&_Arg3, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[5],&_Arg4, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[6], _Arg5, sizeof(unsigned __int64)*_Arg4);
+
+    EventDataDescCreate(&EventData[7], _Arg6, sizeof(const unsigned int)*_Arg4);
+
+    EventDataDescCreate(&EventData[8], _Arg7, sizeof(unsigned __int64)*_Arg4);
+
+    EventDataDescCreate(&EventData[9], _Arg8, sizeof(const unsigned int)*_Arg4);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0xqxqqXR4QR4XR4QR4_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : ExceptionCountsArgs
+//
+#ifndef McTemplateU0xqXR1QR1XR1XR1_def
+#define McTemplateU0xqXR1QR1XR1XR1_def
+ETW_INLINE
+ULONG
+McTemplateU0xqXR1QR1XR1XR1(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ unsigned __int64  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg2,
+    _In_reads_(_Arg1) const unsigned int *_Arg3,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg4,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg5
+    )
+{
+#define McTemplateU0xqXR1QR1XR1XR1_ARGCOUNT 6
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0xqXR1QR1XR1XR1_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3], _Arg2, sizeof(unsigned __int64)*_Arg1);
+
+    EventDataDescCreate(&EventData[4], _Arg3, sizeof(const unsigned int)*_Arg1);
+
+    EventDataDescCreate(&EventData[5], _Arg4, sizeof(unsigned __int64)*_Arg1);
+
+    EventDataDescCreate(&EventData[6], _Arg5, sizeof(unsigned __int64)*_Arg1);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0xqXR1QR1XR1XR1_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : ExceptionStacksArgs
+//
+#ifndef McTemplateU0qqXR1QR1QR1_def
+#define McTemplateU0qqXR1QR1QR1_def
+ETW_INLINE
+ULONG
+McTemplateU0qqXR1QR1QR1(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ const unsigned int  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg2,
+    _In_reads_(_Arg1) const unsigned int *_Arg3,
+    _In_reads_(_Arg1) const unsigned int *_Arg4
+    )
+{
+#define McTemplateU0qqXR1QR1QR1_ARGCOUNT 5
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0qqXR1QR1QR1_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3], _Arg2, sizeof(unsigned __int64)*_Arg1);
+
+    EventDataDescCreate(&EventData[4], _Arg3, sizeof(const unsigned int)*_Arg1);
+
+    EventDataDescCreate(&EventData[5], _Arg4, sizeof(const unsigned int)*_Arg1);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0qqXR1QR1QR1_ARGCOUNT + 1, EventData);
+}
+#endif
+
+//
+//Template from manifest : TransitionCountsArgs
+//
+#ifndef McTemplateU0xqXR1CR1XR1XR1_def
+#define McTemplateU0xqXR1CR1XR1XR1_def
+ETW_INLINE
+ULONG
+McTemplateU0xqXR1CR1XR1XR1(
+    _In_ PMCGEN_TRACE_CONTEXT Context,
+    _In_ PCEVENT_DESCRIPTOR Descriptor,
+    _In_ unsigned __int64  _Arg0,
+    _In_ const unsigned int  _Arg1,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg2,
+    _In_reads_(_Arg1) const UCHAR *_Arg3,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg4,
+    _In_reads_(_Arg1) const unsigned __int64 *_Arg5
+    )
+{
+#define McTemplateU0xqXR1CR1XR1XR1_ARGCOUNT 6
+
+    EVENT_DATA_DESCRIPTOR EventData[McTemplateU0xqXR1CR1XR1XR1_ARGCOUNT + 1];
+
+    EventDataDescCreate(&EventData[1],&_Arg0, sizeof(unsigned __int64)  );
+
+    EventDataDescCreate(&EventData[2],&_Arg1, sizeof(const unsigned int)  );
+
+    EventDataDescCreate(&EventData[3], _Arg2, sizeof(unsigned __int64)*_Arg1);
+
+    EventDataDescCreate(&EventData[4], _Arg3, sizeof(const UCHAR)*_Arg1);
+
+    EventDataDescCreate(&EventData[5], _Arg4, sizeof(unsigned __int64)*_Arg1);
+
+    EventDataDescCreate(&EventData[6], _Arg5, sizeof(unsigned __int64)*_Arg1);
+
+    return McGenEventWriteUM(Context, Descriptor, McTemplateU0xqXR1CR1XR1XR1_ARGCOUNT + 1, EventData);
+}
+#endif
+
 //
 //Template from manifest : SendManifestArgs
 //
@@ -1280,6 +2860,35 @@ McTemplateU0cccchhs(
 #define MSG_task_ProfilerShutdown            0x7000001BL
 #define MSG_task_SamplingRateChange          0x7000001CL
 #define MSG_task_CallEnter                   0x7000001DL
+#define MSG_task_GCFragmentation             0x7000001EL
+#define MSG_task_GCHandleSummary             0x7000001FL
+#define MSG_task_FinalizerSummary            0x70000020L
+#define MSG_task_GCPromotion                 0x70000021L
+#define MSG_task_DuplicateString             0x70000022L
+#define MSG_task_ArrayWaste                  0x70000023L
+#define MSG_task_HeapSampleSummary           0x70000024L
+#define MSG_task_CallCounts                  0x70000025L
+#define MSG_task_CallTree                    0x70000026L
+#define MSG_task_MethodLatency               0x70000027L
+#define MSG_task_CallEdges                   0x70000028L
+#define MSG_task_CallScope                   0x70000029L
+#define MSG_task_FunctionIDDefinition        0x7000002BL
+#define MSG_task_StackDefinition             0x7000002CL
+#define MSG_task_CallStackSample             0x7000002DL
+#define MSG_task_CpuSampleCounts             0x7000002EL
+#define MSG_task_JitMethodTimes              0x7000002FL
+#define MSG_task_JitModuleTimes              0x70000030L
+#define MSG_task_JitTimeHistogram            0x70000031L
+#define MSG_task_PerfMap                     0x70000032L
+#define MSG_task_JitInlineCounts             0x70000033L
+#define MSG_task_StartupTimeline             0x70000034L
+#define MSG_task_StartupAssemblyCosts        0x70000035L
+#define MSG_task_GCPause                     0x70000036L
+#define MSG_task_GCPauseHistogram            0x70000037L
+#define MSG_task_SafePointLaggards           0x70000038L
+#define MSG_task_ExceptionCounts             0x70000039L
+#define MSG_task_ExceptionStacks             0x7000003AL
+#define MSG_task_TransitionCounts            0x7000003BL
 #define MSG_task_SendManifest                0x7000FFFEL
 #define MSG_map_GCRootKind_Stack             0xD0000001L
 #define MSG_map_GCRootKind_Finalizer         0xD0000002L
@@ -1,6 +1,10 @@
 
 extern EnterMethod:proc
-extern CallSampleCount:dword
+extern LeaveMethod:proc
+extern _tls_index:dword
+extern CallSampleCountTlsOffset:qword
+extern CallSamplingEnabled:dword
+extern CallLeaveEnabled:dword
 
 _TEXT segment para 'CODE'
 
@@ -12,7 +16,21 @@ _TEXT segment para 'CODE'
         public  EnterMethodNaked
 EnterMethodNaked     proc    frame
 		.endprolog
-		lock dec [CallSampleCount]
+		; The hook is always installed, do nothing if call sampling is off.
+		cmp    dword ptr [CallSamplingEnabled], 0
+		jne    CountCall
+		ret
+CountCall:
+		; CallScoped anchors are tagged with the low bit, they always take a sample.
+		test   cl, 1
+		jnz    EnterMethodSampleNaked
+		; CallSampleCount is thread local.  Find it from the thread's TLS array (gs:[58h]).
+		; rdx and r8 are free for us to use (EnterMethodSampleNaked does not preserve them either)
+		mov    edx, [_tls_index]
+		mov    r8, gs:[58h]
+		mov    r8, [r8 + rdx*8]
+		add    r8, [CallSampleCountTlsOffset]
+		dec    dword ptr [r8]
 		jle	   EnterMethodSampleNaked
 		ret
 
@@ -41,6 +59,7 @@ EnterMethodSampleNaked     proc    frame
 
         .endprolog
 
+        xor     edx, edx            ; No frame pointer, EnterMethod unwinds instead
         call    EnterMethod
 
         add     rsp, 20h
@@ -56,6 +75,63 @@ EnterMethodSampleNaked     proc    frame
 EnterMethodSampleNaked     endp
 
 
+;************************************************************************************
+;typedef void LeaveMethodNaked(
+;         rcx = FunctionIDOrClientID functionIDOrClientID);
+
+        align   16
+        public  LeaveMethodNaked
+LeaveMethodNaked     proc    frame
+		.endprolog
+		; Only installed for CallTree, MethodLatency and CallScoped, do nothing unless one is on.
+		cmp    dword ptr [CallLeaveEnabled], 0
+		jne    LeaveMethodSampleNaked
+		; CallScoped anchors (tagged with the low bit) always call LeaveMethod.
+		test   cl, 1
+		jnz    LeaveMethodSampleNaked
+		ret
+
+LeaveMethodNaked     endp
+
+;************************************************************************************
+; Calls LeaveMethod.  Unlike the enter hook, we must also preserve the return value (rax or xmm0).
+;typedef void LeaveMethodSampleNaked(
+;         rcx = FunctionIDOrClientID functionIDOrClientID);
+
+        align   16
+		public  LeaveMethodSampleNaked
+LeaveMethodSampleNaked     proc    frame
+        ; save registers
+        push    rax
+        .allocstack 8
+
+        push    r10
+        .allocstack 8
+
+        push    r11
+        .allocstack 8
+
+        sub     rsp, 30h
+        .allocstack 30h
+
+        .endprolog
+
+        movdqu  [rsp + 20h], xmm0
+        call    LeaveMethod
+        movdqu  xmm0, [rsp + 20h]
+
+        add     rsp, 30h
+
+        ; restore registers
+        pop     r11
+        pop     r10
+        pop     rax
+
+        ; return
+        ret
+
+LeaveMethodSampleNaked     endp
+
 ;************************************************************************************
 ;typedef void TailcallMethodNaked(
 ;         rcx = FunctionIDOrClientID functionIDOrClientID);
@@ -64,6 +140,11 @@ EnterMethodSampleNaked     endp
         public  TailcallMethodNaked
 TailcallMethodNaked  proc    frame
 	    .endprolog
+		; A tail call leaves the caller (the callee's enter hook still runs), which only CallTree and MethodLatency care about.
+		cmp    dword ptr [CallLeaveEnabled], 0
+		jne    LeaveMethodSampleNaked
+		test   cl, 1
+		jnz    LeaveMethodSampleNaked
 		jmp EnterMethodNaked
 
 TailcallMethodNaked  endp